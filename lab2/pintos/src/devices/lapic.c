@@ -0,0 +1,315 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/init.h"
+#include "threads/loader.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Interface to the processor's local Advanced Programmable
+   Interrupt Controller (APIC).  Refer to [IA32-v3a] chapter 10
+   "Advanced Programmable Interrupt Controller (APIC)".
+
+   The 8259A PICs remain in charge of device interrupts, which
+   reach the boot CPU through its local APIC's LINT0 pin in
+   "virtual wire" mode.  The local APIC adds a timer of its own,
+   with a resolution far finer than the 8254's timer tick, and
+   lets CPUs interrupt each other with inter-processor interrupts
+   (IPIs).  Every CPU has a local APIC of its own, at the same
+   address. */
+
+/* CPUID feature flags, in EDX for leaf 1. */
+#define CPUID_MSR  (1 << 5)     /* RDMSR and WRMSR supported. */
+#define CPUID_APIC (1 << 9)     /* On-chip local APIC present. */
+
+/* IA32_APIC_BASE model-specific register. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE 0x800  /* APIC global enable. */
+#define APIC_BASE_ADDR 0xfffff000 /* Physical base address. */
+
+/* Local APIC register offsets, in bytes. */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_TPR       0x080   /* Task Priority Register. */
+#define LAPIC_EOI       0x0b0   /* End Of Interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious Interrupt Vector Register. */
+#define LAPIC_ICR_LO    0x300   /* Interrupt Command Register, 31:0. */
+#define LAPIC_ICR_HI    0x310   /* Interrupt Command Register, 63:32. */
+#define LAPIC_LVT_TIMER 0x320   /* LVT Timer Register. */
+#define LAPIC_LVT_LINT0 0x350   /* LVT LINT0 Register. */
+#define LAPIC_LVT_LINT1 0x360   /* LVT LINT1 Register. */
+#define LAPIC_LVT_ERROR 0x370   /* LVT Error Register. */
+#define LAPIC_TIMER_ICR 0x380   /* Timer Initial Count Register. */
+#define LAPIC_TIMER_CCR 0x390   /* Timer Current Count Register. */
+#define LAPIC_TIMER_DCR 0x3e0   /* Timer Divide Configuration Register. */
+
+/* Register bits. */
+#define SVR_ENABLE      0x100   /* APIC software enable. */
+#define LVT_MASKED      0x10000 /* Interrupt masked. */
+#define LVT_PERIODIC    0x20000 /* Timer mode: periodic. */
+#define LVT_NMI         0x400   /* Delivery mode: NMI. */
+#define LVT_EXTINT      0x700   /* Delivery mode: ExtINT. */
+#define DCR_DIVIDE_16   0x3     /* Timer counts at bus clock / 16. */
+#define ICR_INIT        0x500   /* Delivery mode: INIT. */
+#define ICR_STARTUP     0x600   /* Delivery mode: start-up. */
+#define ICR_PENDING     0x1000  /* Delivery status: send pending. */
+#define ICR_ASSERT      0x4000  /* Level: assert. */
+#define ICR_LEVEL       0x8000  /* Trigger mode: level. */
+
+/* Local APIC registers, mapped into kernel virtual memory, or a
+   null pointer if there is no usable local APIC. */
+static volatile uint32_t *lapic;
+
+static void *map_mmio_page (uintptr_t paddr);
+static void enable_apic (void);
+static void setup_lvt (bool boot);
+static void send_icr (uint8_t apic_id, uint32_t command);
+static void spurious_interrupt (struct intr_frame *);
+
+/* Reads register REG. */
+static inline uint32_t
+lapic_read (int reg) 
+{
+  return lapic[reg / 4];
+}
+
+/* Writes VALUE to register REG. */
+static inline void
+lapic_write (int reg, uint32_t value) 
+{
+  lapic[reg / 4] = value;
+}
+
+/* Detects and enables the local APIC.  Returns true if
+   successful, false if the CPU lacks one, in which case the other
+   functions in this file must not be used.
+
+   Must be called after the page allocator and the interrupt
+   system are initialized, and before any user process runs. */
+bool
+lapic_init (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t base_lo, base_hi;
+
+  /* See [IA32-v2a] "CPUID". */
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if ((edx & (CPUID_MSR | CPUID_APIC)) != (CPUID_MSR | CPUID_APIC))
+    return false;
+
+  /* Find the APIC's registers.  See [IA32-v3a] 10.4.4 "Local
+     APIC Status and Location". */
+  asm volatile ("rdmsr" : "=a" (base_lo), "=d" (base_hi) 
+                : "c" (MSR_APIC_BASE));
+  lapic = map_mmio_page (base_lo & APIC_BASE_ADDR);
+
+  intr_register_int (LAPIC_VEC_SPURIOUS, 0, INTR_OFF, spurious_interrupt,
+                     "Spurious APIC Interrupt");
+  enable_apic ();
+  setup_lvt (true);
+
+  printf ("Local APIC %"PRIu8" enabled.\n", lapic_id ());
+  return true;
+}
+
+/* Enables the local APIC of an application processor, which
+   must be at the same address as the boot processor's.  Called
+   by each application processor as it starts up. */
+void
+lapic_init_ap (void) 
+{
+  ASSERT (lapic != NULL);
+
+  enable_apic ();
+  setup_lvt (false);
+}
+
+/* Makes sure that the running CPU's local APIC is globally
+   enabled. */
+static void
+enable_apic (void) 
+{
+  uint32_t base_lo, base_hi;
+
+  asm volatile ("rdmsr" : "=a" (base_lo), "=d" (base_hi) 
+                : "c" (MSR_APIC_BASE));
+  base_lo |= APIC_BASE_ENABLE;
+  asm volatile ("wrmsr" : : "a" (base_lo), "d" (base_hi), 
+                "c" (MSR_APIC_BASE));
+}
+
+/* Sets up the running CPU's local vector table and
+   software-enables its APIC.  On the BOOT processor, keeps PIC
+   interrupts flowing through LINT0 in virtual wire mode; the
+   other processors leave device interrupts to it.  Mask the
+   timer and error interrupts until they are wanted. */
+static void
+setup_lvt (bool boot) 
+{
+  lapic_write (LAPIC_LVT_LINT0, boot ? LVT_EXTINT : LVT_MASKED);
+  lapic_write (LAPIC_LVT_LINT1, LVT_NMI);
+  lapic_write (LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_VEC_TIMER);
+  lapic_write (LAPIC_LVT_ERROR, LVT_MASKED);
+  lapic_write (LAPIC_TIMER_DCR, DCR_DIVIDE_16);
+  lapic_write (LAPIC_TIMER_ICR, 0);
+
+  /* Accept interrupts of every priority and software-enable the
+     APIC. */
+  lapic_write (LAPIC_TPR, 0);
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_VEC_SPURIOUS);
+  lapic_eoi ();
+}
+
+/* Returns true if lapic_init() found and enabled a local
+   APIC. */
+bool
+lapic_present (void) 
+{
+  return lapic != NULL;
+}
+
+/* Returns the running CPU's local APIC ID. */
+uint8_t
+lapic_id (void) 
+{
+  ASSERT (lapic != NULL);
+  return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Signals end of interrupt to the local APIC.  Called by the
+   interrupt core for vectors LAPIC_VEC_FIRST...LAPIC_VEC_LAST. */
+void
+lapic_eoi (void) 
+{
+  ASSERT (lapic != NULL);
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends an INIT IPI to the processor whose local APIC ID is
+   APIC_ID, which resets it and leaves it waiting for a start-up
+   IPI.  See [IA32-v3a] 8.4.4 "MP Initialization Example". */
+void
+lapic_send_init (uint8_t apic_id) 
+{
+  send_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  send_icr (apic_id, ICR_INIT | ICR_LEVEL);
+}
+
+/* Sends a start-up IPI to the processor whose local APIC ID is
+   APIC_ID, which starts it in real mode at physical address
+   PADDR.  PADDR must be page-aligned and below 1 MB. */
+void
+lapic_send_startup (uint8_t apic_id, uintptr_t paddr) 
+{
+  ASSERT (paddr % 4096 == 0 && paddr < 0x100000);
+  send_icr (apic_id, ICR_STARTUP | (paddr >> 12));
+}
+
+/* Sends interrupt VEC_NO, which must be between LAPIC_VEC_FIRST
+   and LAPIC_VEC_LAST, to the processor whose local APIC ID is
+   APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec_no) 
+{
+  ASSERT (vec_no >= LAPIC_VEC_FIRST && vec_no <= LAPIC_VEC_LAST);
+  send_icr (apic_id, vec_no);
+}
+
+/* Writes COMMAND to the interrupt command register, to be sent
+   to the processor whose local APIC ID is APIC_ID, and waits for
+   the APIC to accept it.  See [IA32-v3a] 10.6.1 "Interrupt
+   Command Register (ICR)". */
+static void
+send_icr (uint8_t apic_id, uint32_t command) 
+{
+  ASSERT (lapic != NULL);
+
+  lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << 24);
+  lapic_write (LAPIC_ICR_LO, command);
+  while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+    asm volatile ("pause");
+}
+
+/* Starts the local APIC timer counting down from COUNT, in units
+   of 16 bus clock cycles.  If INTERRUPT is true, the timer raises
+   interrupt LAPIC_VEC_TIMER once when the count reaches 0;
+   otherwise it counts down silently. */
+void
+lapic_timer_start (uint32_t count, bool interrupt) 
+{
+  ASSERT (lapic != NULL);
+  ASSERT (count > 0);
+
+  lapic_write (LAPIC_LVT_TIMER,
+               LAPIC_VEC_TIMER | (interrupt ? 0 : LVT_MASKED));
+  lapic_write (LAPIC_TIMER_ICR, count);
+}
+
+/* Starts the local APIC timer raising interrupt VEC_NO
+   periodically, every COUNT units of 16 bus clock cycles. */
+void
+lapic_timer_periodic (uint8_t vec_no, uint32_t count) 
+{
+  ASSERT (lapic != NULL);
+  ASSERT (count > 0);
+  ASSERT (vec_no >= LAPIC_VEC_FIRST && vec_no <= LAPIC_VEC_LAST);
+
+  lapic_write (LAPIC_LVT_TIMER, vec_no | LVT_PERIODIC);
+  lapic_write (LAPIC_TIMER_ICR, count);
+}
+
+/* Stops the local APIC timer. */
+void
+lapic_timer_stop (void) 
+{
+  ASSERT (lapic != NULL);
+  lapic_write (LAPIC_TIMER_ICR, 0);
+}
+
+/* Returns the local APIC timer's current count, which is 0 once
+   it has run out. */
+uint32_t
+lapic_timer_count (void) 
+{
+  ASSERT (lapic != NULL);
+  return lapic_read (LAPIC_TIMER_CCR);
+}
+
+/* Maps the page of memory-mapped I/O registers at physical
+   address PADDR into the kernel's address space, uncached, and
+   returns its kernel virtual address.  Such pages lie far above
+   physical RAM, so they are mapped at the virtual address equal
+   to their physical address, which is above PHYS_BASE and thus
+   visible only to the kernel.  Page directories created later
+   copy the mapping from init_page_dir. */
+static void *
+map_mmio_page (uintptr_t paddr) 
+{
+  void *vaddr = (void *) paddr;
+  uint32_t *pde, *pt;
+
+  ASSERT (pg_ofs (vaddr) == 0);
+  ASSERT (is_kernel_vaddr (vaddr));
+  ASSERT (vaddr >= ptov (init_ram_pages * PGSIZE));
+
+  pde = &init_page_dir[pd_no (vaddr)];
+  if (*pde == 0)
+    *pde = pde_create (palloc_get_page (PAL_ASSERT | PAL_ZERO));
+  pt = pde_get_pt (*pde);
+  pt[pt_no (vaddr)] = paddr | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+
+  /* Flush the TLB.  See [IA32-v3a] 3.12 "Translation Lookaside
+     Buffers (TLBs)". */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+  return vaddr;
+}
+
+/* Handler for the APIC's spurious interrupt, which may be raised
+   when an interrupt is withdrawn at the last moment.  It must not
+   be acknowledged, so there is nothing to do. */
+static void
+spurious_interrupt (struct intr_frame *f UNUSED) 
+{
+}
@@ -0,0 +1,35 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors used by the local APIC.
+
+   Vectors LAPIC_VEC_FIRST...LAPIC_VEC_LAST are external
+   interrupts, like the ones from the 8259A PICs, except that they
+   are acknowledged with lapic_eoi() instead of on the PIC.  The
+   spurious-interrupt vector must not be acknowledged at all. */
+#define LAPIC_VEC_FIRST 0xf0
+#define LAPIC_VEC_TIMER 0xf0    /* Local APIC timer. */
+#define LAPIC_VEC_TICK 0xf1     /* Timer tick on secondary CPUs. */
+#define LAPIC_VEC_RESCHED 0xf2  /* Reschedule IPI. */
+#define LAPIC_VEC_LAST 0xfe
+#define LAPIC_VEC_SPURIOUS 0xff /* Spurious interrupt. */
+
+bool lapic_init (void);
+void lapic_init_ap (void);
+bool lapic_present (void);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+
+void lapic_send_init (uint8_t apic_id);
+void lapic_send_startup (uint8_t apic_id, uintptr_t paddr);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec_no);
+
+void lapic_timer_start (uint32_t count, bool interrupt);
+void lapic_timer_periodic (uint8_t vec_no, uint32_t count);
+void lapic_timer_stop (void);
+uint32_t lapic_timer_count (void);
+
+#endif /* devices/lapic.h */
@@ -1,5 +1,6 @@
 #include "devices/pit.h"
 #include <debug.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
@@ -11,9 +12,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -39,6 +37,9 @@
        it is 1, for the second half it is 0.  This is useful for
        generating a tone on a speaker.
 
+     - Mode 0, a single pulse at the end of the count, is set up
+       by pit_start_oneshot() instead.
+
      - Other modes are less useful.
 
    FREQUENCY is the number of periods per second, in Hz. */
@@ -81,3 +82,68 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts the given CHANNEL counting down COUNT PIT cycles in
+   mode 0, "interrupt on terminal count".  The channel's output
+   goes high once, when the count reaches 0, and stays high until
+   the channel is reprogrammed, so on channel 0 this yields a
+   single timer interrupt COUNT / PIT_HZ seconds from now.  A
+   COUNT of 0 is treated as 65536.
+
+   After reaching 0 the counter keeps counting down, wrapping
+   around to 65535, without raising any further interrupts. */
+void
+pit_start_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of CHANNEL's counter, that is, the
+   number of PIT cycles left before it reaches 0. */
+uint16_t
+pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  uint16_t count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  /* Latch the counter so that its two bytes are read
+     consistently, then read it low byte first. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  return count;
+}
+
+/* Returns true if CHANNEL's output is high, which in mode 0
+   means that its one-shot count has run out, even if the counter
+   has since wrapped around and is still counting down.  Uses the
+   8254's read-back command to latch the channel's status byte,
+   whose bit 7 is the output. */
+bool
+pit_output (int channel)
+{
+  enum intr_level old_level;
+  uint8_t status;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0xe0 | (1 << (channel + 1)));
+  status = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  return (status & 0x80) != 0;
+}
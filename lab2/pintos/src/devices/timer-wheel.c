@@ -0,0 +1,270 @@
+#include "devices/timer-wheel.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/* The wheel has a fine-grained first level of 256 slots, one per
+   tick, and four coarser levels of 64 slots each.  A slot at
+   level N covers 256 * 64**(N-1) ticks.  Timers are filed in the
+   finest level whose span reaches their expiry; whenever the
+   level-0 index wraps around to 0, the next slot of level 1 is
+   "cascaded", that is, its timers are refiled into level 0, and
+   so on up the hierarchy.  This is the classic scheme from
+   [Varghese87], as used by many Unix kernels.
+
+   Together the levels span 2**32 ticks.  Timers further out
+   than that are filed at the far end and simply cascade again
+   until they come due. */
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
+#define MAX_TIMEOUT 0xffffffffLL
+
+/* Level 0 and levels 1...4 of the wheel. */
+static struct list tv1[TVR_SIZE];
+static struct list tvn[TVN_LEVELS][TVN_SIZE];
+
+/* Next tick to be processed by timer_wheel_run().  Every timer
+   due before this tick has already run. */
+static int64_t wheel_base;
+
+/* Number of pending timers. */
+static unsigned pending_cnt;
+
+static void internal_add (struct timer *);
+static void internal_del (struct timer *);
+static int cascade (int level);
+
+/* Initializes T to call FUNC with AUX when it expires.  T is not
+   pending until it is added with timer_add(). */
+void
+timer_setup (struct timer *t, timer_func *func, void *aux) 
+{
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  t->func = func;
+  t->aux = aux;
+  t->expires = 0;
+  t->pending = false;
+}
+
+/* Arranges for T, which must not be pending, to run TICKS timer
+   ticks from now.  If TICKS is 0 or negative, T runs on the next
+   tick. */
+void
+timer_add (struct timer *t, int64_t ticks) 
+{
+  enum intr_level old_level;
+
+  ASSERT (t != NULL);
+  ASSERT (!t->pending);
+
+  old_level = intr_disable ();
+  t->expires = timer_ticks () + (ticks > 0 ? ticks : 1);
+  internal_add (t);
+  intr_set_level (old_level);
+}
+
+/* Rearms T to run TICKS timer ticks from now, whether or not it
+   is currently pending.  Returns true if T was pending. */
+bool
+timer_mod (struct timer *t, int64_t ticks) 
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  was_pending = t->pending;
+  if (was_pending)
+    internal_del (t);
+  timer_add (t, ticks);
+  intr_set_level (old_level);
+
+  return was_pending;
+}
+
+/* Cancels T if it is pending.  Returns true if T was pending,
+   false if it had already run or was never added.
+
+   T's callback will not be called after this function returns,
+   because callbacks run with interrupts off. */
+bool
+timer_cancel (struct timer *t) 
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  was_pending = t->pending;
+  if (was_pending)
+    internal_del (t);
+  intr_set_level (old_level);
+
+  return was_pending;
+}
+
+/* Returns true if T has been added and has not yet run or been
+   cancelled. */
+bool
+timer_pending (const struct timer *t) 
+{
+  return t->pending;
+}
+
+/* Initializes the timing wheel.  NOW is the current timer
+   tick. */
+void
+timer_wheel_init (int64_t now) 
+{
+  int i, j;
+
+  for (i = 0; i < TVR_SIZE; i++)
+    list_init (&tv1[i]);
+  for (i = 0; i < TVN_LEVELS; i++)
+    for (j = 0; j < TVN_SIZE; j++)
+      list_init (&tvn[i][j]);
+  wheel_base = now;
+  pending_cnt = 0;
+}
+
+/* Runs every timer that has come due, up to and including tick
+   NOW.  Called from the timer interrupt handler. */
+void
+timer_wheel_run (int64_t now) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_base <= now) 
+    {
+      struct list expired;
+      int index;
+
+      /* Nothing to cascade or run: skip straight to NOW. */
+      if (pending_cnt == 0)
+        {
+          wheel_base = now + 1;
+          break;
+        }
+
+      /* Each time level 0 wraps around, refill it from level 1,
+         and so on. */
+      index = wheel_base & TVR_MASK;
+      if (index == 0)
+        {
+          int level;
+          for (level = 0; level < TVN_LEVELS; level++)
+            if (cascade (level) != 0)
+              break;
+        }
+
+      /* Advance before running the callbacks, so that any timer
+         they add lands in a slot that has not been run yet. */
+      wheel_base++;
+
+      list_init (&expired);
+      if (!list_empty (&tv1[index]))
+        list_splice (list_end (&expired), list_begin (&tv1[index]),
+                     list_end (&tv1[index]));
+      while (!list_empty (&expired)) 
+        {
+          struct timer *t = list_entry (list_pop_front (&expired),
+                                        struct timer, elem);
+          t->pending = false;
+          pending_cnt--;
+          t->func (t->aux);
+        }
+    }
+}
+
+/* Returns a tick no later than the earliest expiry of any
+   pending timer, or INT64_MAX if no timer is pending.  The result
+   is exact for timers due before level 0 of the wheel next wraps
+   around; if there are none, it is the tick at which it wraps,
+   when the upper levels are cascaded. */
+int64_t
+timer_wheel_next_expiry (void) 
+{
+  int64_t tick;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (pending_cnt == 0)
+    return INT64_MAX;
+  for (tick = wheel_base; ; tick++)
+    if (!list_empty (&tv1[tick & TVR_MASK]) || (tick & TVR_MASK) == 0)
+      return tick;
+}
+
+/* Files T in the wheel slot for its expiry time. */
+static void
+internal_add (struct timer *t) 
+{
+  int64_t expires = t->expires;
+  int64_t delta = expires - wheel_base;
+  struct list *slot;
+
+  if (delta < 0)
+    {
+      /* Already due: run on the next tick processed. */
+      slot = &tv1[wheel_base & TVR_MASK];
+    }
+  else if (delta < TVR_SIZE)
+    slot = &tv1[expires & TVR_MASK];
+  else 
+    {
+      int level, shift;
+
+      if (delta > MAX_TIMEOUT)
+        expires = wheel_base + MAX_TIMEOUT;
+      for (level = 0, shift = TVR_BITS; level < TVN_LEVELS - 1; 
+           level++, shift += TVN_BITS)
+        if (delta < 1LL << (shift + TVN_BITS))
+          break;
+      slot = &tvn[level][(expires >> shift) & TVN_MASK];
+    }
+
+  list_push_back (slot, &t->elem);
+  t->pending = true;
+  pending_cnt++;
+}
+
+/* Removes pending timer T from its wheel slot. */
+static void
+internal_del (struct timer *t) 
+{
+  ASSERT (t->pending);
+
+  list_remove (&t->elem);
+  t->pending = false;
+  pending_cnt--;
+}
+
+/* Refiles the timers in the current slot of level LEVEL (0 for
+   the first level above tv1) into finer levels.  Returns the
+   slot index, so that the caller knows to cascade the next level
+   up when it is 0. */
+static int
+cascade (int level) 
+{
+  int shift = TVR_BITS + level * TVN_BITS;
+  int index = (wheel_base >> shift) & TVN_MASK;
+  struct list *slot = &tvn[level][index];
+
+  while (!list_empty (slot)) 
+    {
+      struct timer *t = list_entry (list_pop_front (slot),
+                                    struct timer, elem);
+      pending_cnt--;
+      internal_add (t);
+    }
+  return index;
+}
@@ -0,0 +1,46 @@
+#ifndef DEVICES_TIMER_WHEEL_H
+#define DEVICES_TIMER_WHEEL_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel timers: callbacks that run a given number of timer
+   ticks in the future, without tying up a thread.
+
+   Pending timers are kept in a hierarchical timing wheel, so
+   adding and cancelling a timer take constant time no matter
+   how many are pending, and a timer tick only ever looks at the
+   timers that expire on that tick (plus, once every 256 ticks, a
+   batch of far-off timers that are moved down a level).
+
+   Timer callbacks run in the timer interrupt handler, so they
+   must not sleep.  They may add, modify, or cancel timers,
+   including their own.  The functions below may be called from
+   kernel threads or from external interrupt handlers. */
+
+/* Timer callback. */
+typedef void timer_func (void *aux);
+
+/* A kernel timer. */
+struct timer
+  {
+    struct list_elem elem;      /* Element in a wheel slot. */
+    int64_t expires;            /* Tick at which to run FUNC. */
+    timer_func *func;           /* Function to call. */
+    void *aux;                  /* Argument for FUNC. */
+    bool pending;               /* On the wheel, not yet run? */
+  };
+
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_add (struct timer *, int64_t ticks);
+bool timer_mod (struct timer *, int64_t ticks);
+bool timer_cancel (struct timer *);
+bool timer_pending (const struct timer *);
+
+/* For use by devices/timer.c. */
+void timer_wheel_init (int64_t now);
+void timer_wheel_run (int64_t now);
+int64_t timer_wheel_next_expiry (void);
+
+#endif /* devices/timer-wheel.h */
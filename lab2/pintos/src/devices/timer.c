@@ -3,39 +3,207 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/lapic.h"
 #include "devices/pit.h"
+#include "devices/timer-wheel.h"
 #include "threads/interrupt.h"
+#include "threads/smp.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
-#if TIMER_FREQ < 19
-#error 8254 timer requires TIMER_FREQ >= 19
-#endif
-#if TIMER_FREQ > 1000
-#error TIMER_FREQ <= 1000 recommended
-#endif
+/* Number of timer interrupts per second.  The 8254 requires at
+   least 19 Hz; above TIMER_FREQ_PIT_MAX Hz, the local APIC timer
+   takes over from it once timer_calibrate() has measured it. */
+int timer_freq = TIMER_FREQ_DEFAULT;
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.
+
+   On i386, reading this 64-bit counter takes two loads, between
+   which the timer interrupt could change it.  Rather than turning
+   interrupts off to read it, readers check ticks_seq, which is
+   incremented before and after every change to TICKS, so that it
+   is odd while a change is in progress.  A reader that sees
+   ticks_seq odd, or different afterward, read a torn value and
+   tries again.  Only code running with interrupts off may change
+   TICKS, through advance_ticks(). */
 static int64_t ticks;
+static unsigned ticks_seq;
+
+/* List of threads blocked in timer_sleep(), ordered by the tick
+   at which each should wake up (`blocked_until'), earliest
+   first.  The timer interrupt only ever looks at the front of
+   this list. */
+static struct list sleep_list;
+
+/* Number of ticks on which timer_interrupt() woke at least one
+   sleeping thread, and number of threads it woke. */
+static int64_t wakeup_events;
+static int64_t wakeups;
+
+/* Cost of the parts of the timer interrupt, in TSC cycles. */
+enum tick_part 
+  {
+    TICK_THREAD,                /* thread_tick(). */
+    TICK_SLEEPERS,              /* Waking sleeping threads. */
+    TICK_TIMERS,                /* Running kernel timers. */
+    TICK_YIELD,                 /* Yielding on return. */
+    TICK_TOTAL,                 /* The whole handler, less yielding. */
+    TICK_PART_CNT
+  };
+
+/* Number of histogram buckets.  Bucket 0 counts costs of 0 or 1
+   cycle, bucket I > 0 costs of 2**I to 2**(I+1) - 1 cycles, and
+   the last bucket everything above. */
+#define TICK_COST_BUCKETS 32
+
+/* Statistics on the cost of one part of the timer interrupt. */
+struct tick_cost 
+  {
+    const char *name;           /* Name of the part. */
+    int64_t cnt;                /* Number of samples. */
+    uint64_t total;             /* Sum of all samples. */
+    uint64_t min;               /* Smallest sample. */
+    uint64_t max;               /* Largest sample. */
+    int64_t hist[TICK_COST_BUCKETS]; /* Histogram of samples. */
+  };
+
+static struct tick_cost tick_costs[TICK_PART_CNT] = 
+  {
+    {"thread_tick", 0, 0, UINT64_MAX, 0, {0}},
+    {"sleepers", 0, 0, UINT64_MAX, 0, {0}},
+    {"timers", 0, 0, UINT64_MAX, 0, {0}},
+    {"yield", 0, 0, UINT64_MAX, 0, {0}},
+    {"total", 0, 0, UINT64_MAX, 0, {0}},
+  };
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second, always.
+   If true, the periodic tick is stopped while the CPU is idle and
+   the PIT is instead programmed to interrupt once, at the next
+   tick on which something is due to happen.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Source of the timer tick: the PIT, or the local APIC timer if
+   lapic_tick is true.  Either counts down COUNTS_PER_TICK times
+   per tick. */
+static bool lapic_tick;
+static uint32_t counts_per_tick;
+
+/* Dynamic tick state.  While the tick source is in one-shot
+   mode, oneshot_ticks is the number of ticks that will have
+   elapsed when it fires and oneshot_count is the count it was
+   started with.  Both are 0 while it runs periodically. */
+static int64_t oneshot_ticks;
+static uint32_t oneshot_count;
+
+/* Number of timer ticks that passed without an interrupt because
+   the CPU was idle. */
+static int64_t skipped_ticks;
+
+/* Number of timer interrupts that advanced the tick count.  Less
+   than the tick count by the ticks skipped while idle. */
+static int64_t tick_interrupts;
+
+/* High-resolution clock.
+
+   The CPU's time stamp counter (TSC) and the local APIC timer are
+   calibrated against the timer tick by timer_calibrate().  If the
+   CPU lacks a TSC, cycles_per_tick stays 0 and timer_now_ns()
+   counts in whole ticks.  These variables are written only
+   before any other thread runs, so reading them later needs no
+   synchronization. */
+static bool tsc_present;                /* Does the CPU have a TSC? */
+static uint64_t cycles_per_tick;        /* TSC cycles per timer tick. */
+static uint64_t boot_cycles;            /* TSC value at calibration. */
+static uint32_t ns_mult;                /* ns = cycles * ns_mult */
+static int ns_shift;                    /*      >> ns_shift. */
+
+/* Number of ticks over which the TSC and APIC timer are
+   calibrated. */
+#define HIRES_CALIBRATE_TICKS 4
+
+/* High-resolution sleeps.
+
+   Sleeps shorter than a timer tick are timed with the TSC and
+   ended by a one-shot interrupt from the local APIC timer.  If
+   the CPU lacks either, or the APIC timer drives the tick,
+   lapic_counts_per_tick stays 0 and such sleeps busy-wait
+   instead. */
+static uint32_t lapic_counts_per_tick;  /* APIC timer counts per tick. */
+
+/* The other CPUs' timer ticks.  Each application processor's
+   local APIC timer interrupts it TIMER_FREQ times per second,
+   counting down AP_COUNTS_PER_TICK times per tick, so that it
+   can enforce time slices.  Only the boot CPU's tick advances
+   the tick count, wakes sleeping threads, and runs kernel
+   timers. */
+static uint32_t ap_counts_per_tick;
+
+/* Sub-tick sleeps shorter than this many nanoseconds busy-wait,
+   since blocking and waking up again would take about as long. */
+#define HIRES_MIN_NS 20000
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+
+/* List of threads blocked in hires_sleep(), ordered by
+   `wakeup_cycles', earliest first.  The APIC timer is always
+   armed for the thread at the front, if any. */
+static struct list hires_list;
+
 static intr_handler_func timer_interrupt;
+static intr_handler_func hires_interrupt;
+static intr_handler_func ap_tick_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
-void unblock_if_blocked_enough(struct thread *t, void *aux);
+static void wake_sleepers (void);
+static void skip_ticks (int64_t);
+static void advance_ticks (int64_t);
+static void account_tick (enum tick_part, uint64_t cycles);
+static void print_tick_cost (const struct tick_cost *);
+static void sleep_until (struct thread *, int64_t earliest, int64_t latest);
+static void hires_calibrate (void);
+static void lapic_tick_start (uint32_t counts);
+static uint32_t tick_count (void);
+static uint32_t tick_count_max (void);
+static bool tick_expired (void);
+static void tick_oneshot (uint32_t count);
+static void tick_periodic (void);
+static void hires_sleep (int64_t ns);
+static void hires_arm (void);
+static bool hires_less (const struct list_elem *, const struct list_elem *,
+                        void *aux);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
-   and registers the corresponding interrupt. */
+   and registers the corresponding interrupt.  The PIT drives the
+   timer at first, whatever TIMER_FREQ is. */
 void
 timer_init (void) 
 {
+  uint32_t eax, ebx, ecx, edx;
+
+  if (TIMER_FREQ < TIMER_FREQ_MIN || TIMER_FREQ > TIMER_FREQ_MAX)
+    PANIC ("timer frequency %d Hz not in range %d...%d Hz",
+           TIMER_FREQ, TIMER_FREQ_MIN, TIMER_FREQ_MAX);
+
+  /* See [IA32-v2a] "CPUID".  EDX bit 4 is set if the CPU has a
+     TSC. */
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  tsc_present = (edx & (1 << 4)) != 0;
+
+  list_init (&sleep_list);
+  list_init (&hires_list);
+  timer_wheel_init (ticks);
+  counts_per_tick = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -65,15 +233,32 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  hires_calibrate ();
 }
 
-/* Returns the number of timer ticks since the OS booted. */
+/* Returns the number of timer ticks since the OS booted.  Does
+   not disable interrupts. */
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  /* An interrupt handler runs with interrupts off, so the count
+     cannot change under it: the value read is the one for the
+     current tick. */
+  if (intr_context ())
+    return ticks;
+
+  do 
+    {
+      seq = ticks_seq;
+      barrier ();
+      t = ticks;
+      barrier ();
+    }
+  while ((seq & 1) != 0 || seq != ticks_seq);
   return t;
 }
 
@@ -85,22 +270,157 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the current value of the CPU's time stamp counter, or
+   0 if it has none.  May be called from any context, with
+   interrupts on or off.  Meaningful only in comparison with
+   other values it returned; use timer_now_ns() for a time. */
+uint64_t
+timer_cycles (void) 
+{
+  uint64_t tsc;
+
+  if (!tsc_present)
+    return 0;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the number of nanoseconds since the OS booted, as
+   measured by the TSC.  The result never decreases.  May be
+   called from any context, including interrupt handlers, and
+   does not disable interrupts.
+
+   Before timer_calibrate(), or if the CPU has no TSC, the result
+   only changes once per timer tick. */
+int64_t
+timer_now_ns (void) 
+{
+  uint64_t cycles;
+
+  if (cycles_per_tick == 0)
+    return timer_ticks () * NS_PER_TICK;
+
+  /* Compute CYCLES * ns_mult >> ns_shift in two halves, since the
+     full product needs more than 64 bits. */
+  cycles = timer_cycles () - boot_cycles;
+  return ((((cycles >> 32) * ns_mult) << (32 - ns_shift))
+          + (((cycles & 0xffffffff) * ns_mult) >> ns_shift));
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. TODO block thread using thread_block and set timer for how long it should remain blocked.*/
+   be turned on.
+
+   The thread is inserted into sleep_list in wake-up order and
+   blocked; timer_interrupt() unblocks it once its wake-up tick
+   arrives.  The running thread's timer slack lets it sleep up to
+   that many ticks longer, so that it can be woken on the same
+   tick as other threads. */
 void
 timer_sleep (int64_t ticks) 
 {
-  if(ticks > 0)
-  {
-  	int64_t start = timer_ticks ();
-  	enum intr_level old_level = intr_disable ();
-  	thread_current()->blocked_until = timer_ticks() + ticks;
-  	thread_current()->isSleeping = true; 
-  	thread_block();
-  	thread_current()->isSleeping = false; 
-  	intr_set_level (old_level);
+  ASSERT (intr_get_level () == INTR_ON);
+  if (ticks <= 0)
+    return;
+
+  timer_sleep_until (timer_ticks () + ticks);
+}
+
+/* Sleeps until the tick count reaches DEADLINE, or returns at
+   once if it already has.  Interrupts must be turned on.
+
+   Unlike a loop of timer_sleep() calls, a loop that advances
+   DEADLINE by a fixed amount does not drift, however late the
+   thread gets to run after each wake-up.  The thread's timer
+   slack still applies. */
+void
+timer_sleep_until (int64_t deadline) 
+{
+  struct thread *cur;
+  enum intr_level old_level;
+
+  ASSERT (intr_get_level () == INTR_ON);
 
-  }
+  old_level = intr_disable ();
+  if (deadline > ticks) 
+    {
+      cur = thread_current ();
+      sleep_until (cur, deadline, deadline + cur->timer_slack);
+      thread_sleep ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Initializes P as a periodic timer whose deadlines fall every
+   PERIOD ticks, on the ticks that are PHASE more than a multiple
+   of PERIOD.  Its first deadline is the first such tick after
+   the current one. */
+void
+timer_periodic_init (struct timer_periodic *p, int64_t period,
+                     int64_t phase) 
+{
+  int64_t now = timer_ticks ();
+
+  ASSERT (p != NULL);
+  ASSERT (period > 0);
+  ASSERT (phase >= 0 && phase < period);
+
+  p->period = period;
+  p->next = now - now % period + phase;
+  if (p->next <= now)
+    p->next += period;
+  p->overruns = 0;
+}
+
+/* Sleeps until P's next deadline and advances it by one period.
+   Interrupts must be turned on.
+
+   If the deadline has already passed, returns at once.  Any
+   further deadlines that have passed as well are skipped, so
+   that the caller does not fall ever further behind, and added
+   to P's overrun count.  Returns the number of deadlines skipped
+   in this call. */
+int64_t
+timer_periodic_wait (struct timer_periodic *p) 
+{
+  int64_t now = timer_ticks ();
+  int64_t missed = 0;
+
+  ASSERT (p != NULL);
+
+  if (now >= p->next) 
+    {
+      missed = (now - p->next) / p->period;
+      p->next += missed * p->period;
+      p->overruns += missed;
+    }
+  else
+    timer_sleep_until (p->next);
+  p->next += p->period;
+  return missed;
+}
+
+/* Returns the number of ticks on which sleeping threads were
+   woken up since boot.  Threads woken on the same tick count
+   once, since they cost a single reschedule. */
+int64_t
+timer_wakeup_events (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t events = wakeup_events;
+  intr_set_level (old_level);
+  return events;
+}
+
+/* Returns the number of timer interrupts that have advanced the
+   tick count since boot.  In tickless mode, this falls behind
+   timer_ticks() while the CPU is idle. */
+int64_t
+timer_interrupt_cnt (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t cnt = tick_interrupts;
+  intr_set_level (old_level);
+  return cnt;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -166,27 +486,282 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic timer
+   interrupt by a single one at the next tick on which a sleeping
+   thread or kernel timer is due, or as far ahead as the PIT's
+   16-bit counter reaches, whichever comes first. */
+void
+timer_idle_enter (void) 
+{
+  int64_t next, delta, max_ticks;
+  uint32_t phase;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0)
+    return;
+
+  next = timer_wheel_next_expiry ();
+  if (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->blocked_until < next)
+        next = t->blocked_until;
+    }
+  delta = next - ticks;
+  if (delta < 2)
+    return;
+
+  /* Keep the one-shot interrupt in phase with the periodic tick:
+     PHASE counts remain until the next tick would have fired. */
+  phase = tick_count ();
+  if (phase == 0 || phase > counts_per_tick)
+    return;
+  max_ticks = 1 + (tick_count_max () - phase) / counts_per_tick;
+  if (delta > max_ticks)
+    delta = max_ticks;
+  if (delta < 2)
+    return;
+
+  oneshot_ticks = delta;
+  oneshot_count = phase + (delta - 1) * counts_per_tick;
+  tick_oneshot (oneshot_count);
+}
+
+/* Called by the scheduler, with interrupts off, whenever the
+   boot CPU's idle thread gives up the CPU, which it does after
+   every interrupt that wakes the CPU.  If that interrupt was not the
+   one-shot timer interrupt, brings the tick count up to date
+   and arms a one-shot interrupt for the next tick boundary, upon
+   which the periodic tick resumes. */
+void
+timer_idle_exit (void) 
+{
+  uint32_t left, used, phase;
+  int64_t elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0)
+    return;
+
+  /* If the count has run out, the timer interrupt is pending and
+     will do the catching up itself.  Check for that after reading
+     the count, so that a count read after it ran out, and wrapped
+     around on the PIT, is never taken for time still left. */
+  left = tick_count ();
+  if (tick_expired () || left == 0 || left > oneshot_count)
+    return;
+
+  /* The first tick boundary was PHASE counts after the one-shot
+     started, and the rest followed every COUNTS_PER_TICK. */
+  used = oneshot_count - left;
+  phase = oneshot_count - (oneshot_ticks - 1) * counts_per_tick;
+  elapsed = used < phase ? 0 : 1 + (used - phase) / counts_per_tick;
+  skip_ticks (elapsed);
+
+  oneshot_ticks = 1;
+  oneshot_count = phase + elapsed * counts_per_tick - used;
+  tick_oneshot (oneshot_count);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" ticks skipped while idle\n", skipped_ticks);
+  printf ("Timer: %"PRId64" threads woken in %"PRId64" wakeup events\n",
+          wakeups, wakeup_events);
+  if (tsc_present) 
+    {
+      enum tick_part part;
+
+      for (part = 0; part < TICK_PART_CNT; part++)
+        print_tick_cost (&tick_costs[part]);
+    }
 }
 
-/* Timer interrupt handler. TODO thread_foreach to iterate over threads. thread_unblock to activate and update sleep-timer.*/
+/* Accounts CYCLES spent by the yield at the end of a handler for
+   interrupt VEC_NO, if it was the timer interrupt.  Called by the
+   interrupt code once the yield is complete. */
+void
+timer_account_yield (uint8_t vec_no, uint64_t cycles) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (vec_no == (lapic_tick ? LAPIC_VEC_TIMER : 0x20) && tsc_present)
+    account_tick (TICK_YIELD, cycles);
+}
+
+/* Timer interrupt handler, for both the PIT and the local APIC
+   timer. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
-  ticks++;
+  uint64_t start, thread_done, sleepers_done, timers_done;
+
+  /* Once the APIC timer has taken over, ignore the PIT's last
+     interrupt. */
+  if (lapic_tick && args->vec_no != LAPIC_VEC_TIMER)
+    return;
+
+  start = timer_cycles ();
+  tick_interrupts++;
+
+  /* Coming out of one-shot mode, account for the ticks that had
+     no interrupt of their own and go back to periodic mode. */
+  if (oneshot_ticks != 0) 
+    {
+      skip_ticks (oneshot_ticks - 1);
+      oneshot_ticks = oneshot_count = 0;
+      tick_periodic ();
+    }
+
+  advance_ticks (1);
   thread_tick ();
-  thread_foreach(unblock_if_blocked_enough, NULL);
+  thread_done = timer_cycles ();
+  wake_sleepers ();
+  sleepers_done = timer_cycles ();
+  timer_wheel_run (ticks);
+  timers_done = timer_cycles ();
+
+  if (tsc_present) 
+    {
+      account_tick (TICK_THREAD, thread_done - start);
+      account_tick (TICK_SLEEPERS, sleepers_done - thread_done);
+      account_tick (TICK_TIMERS, timers_done - sleepers_done);
+      account_tick (TICK_TOTAL, timers_done - start);
+    }
+}
+
+/* Adds a sample of CYCLES to the statistics for PART of the timer
+   interrupt. */
+static void
+account_tick (enum tick_part part, uint64_t cycles) 
+{
+  struct tick_cost *c = &tick_costs[part];
+  int bucket;
+
+  c->cnt++;
+  c->total += cycles;
+  if (cycles < c->min)
+    c->min = cycles;
+  if (cycles > c->max)
+    c->max = cycles;
+
+  for (bucket = 0; bucket < TICK_COST_BUCKETS - 1; bucket++)
+    if ((cycles >> (bucket + 1)) == 0)
+      break;
+  c->hist[bucket]++;
+}
+
+/* Prints the statistics in C, followed by the nonempty buckets of
+   its histogram, each labeled with its lower bound as a power of
+   2. */
+static void
+print_tick_cost (const struct tick_cost *c) 
+{
+  int bucket;
+
+  if (c->cnt == 0)
+    return;
+  printf ("Timer: %s: %"PRId64" samples, cycles min %"PRIu64
+          ", avg %"PRIu64", max %"PRIu64"\n", c->name, c->cnt,
+          c->min, c->total / c->cnt, c->max);
+  printf ("Timer: %s:", c->name);
+  for (bucket = 0; bucket < TICK_COST_BUCKETS; bucket++)
+    if (c->hist[bucket] != 0)
+      printf (" 2^%d:%"PRId64, bucket, c->hist[bucket]);
+  printf ("\n");
+}
+
+/* Unblocks every thread in sleep_list whose wake-up tick has
+   arrived.  Because the list is kept in wake-up order, this
+   touches only the threads that are due plus the first one that
+   is not, however many threads are asleep. */
+static void
+wake_sleepers (void)
+{
+  int64_t woken = wakeups;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->blocked_until > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+      wakeups++;
+    }
+  if (wakeups != woken)
+    wakeup_events++;
 }
 
-void unblock_if_blocked_enough(struct thread *t, void *aux)
+/* Advances the tick count by SKIPPED ticks that passed while the
+   CPU was idle with the periodic tick stopped. */
+static void
+skip_ticks (int64_t skipped) 
+{
+  advance_ticks (skipped);
+  skipped_ticks += skipped;
+  thread_idle_ticks (skipped);
+}
+
+/* Adds N to the tick count, in a way that lets timer_ticks()
+   read it safely without disabling interrupts. */
+static void
+advance_ticks (int64_t n) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  ticks_seq++;
+  barrier ();
+  ticks += n;
+  barrier ();
+  ticks_seq++;
+}
+
+/* Puts thread T in sleep_list to be woken on some tick between
+   EARLIEST and LATEST, inclusive.  Picks the earliest tick in
+   that range on which other threads already wake up, if there is
+   one, so that they all wake up together.  Otherwise, picks the
+   one tick in the range that is a multiple of the range's
+   length, so that independent sleepers with the same slack tend
+   to pick the same ticks too.  Threads with equal wake-up ticks
+   wake in the order in which they went to sleep. */
+static void
+sleep_until (struct thread *t, int64_t earliest, int64_t latest) 
 {
-  if( t->isSleeping && t->status == THREAD_BLOCKED && timer_ticks() >= t->blocked_until ){
-    thread_unblock(t);
-  }
+  struct list_elem *e;
+  int64_t wakeup;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (earliest <= latest);
+
+  for (e = list_begin (&sleep_list); e != list_end (&sleep_list);
+       e = list_next (e))
+    if (list_entry (e, struct thread, elem)->blocked_until >= earliest)
+      break;
+
+  if (e != list_end (&sleep_list)
+      && list_entry (e, struct thread, elem)->blocked_until <= latest)
+    wakeup = list_entry (e, struct thread, elem)->blocked_until;
+  else
+    wakeup = ROUND_UP (earliest, latest - earliest + 1);
+
+  while (e != list_end (&sleep_list)
+         && list_entry (e, struct thread, elem)->blocked_until <= wakeup)
+    e = list_next (e);
+
+  t->blocked_until = wakeup;
+  list_insert (e, &t->elem);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -222,6 +797,271 @@ busy_wait (int64_t loops)
     barrier ();
 }
 
+/* Measures cycles_per_tick, if the CPU has a TSC, and the APIC
+   timer's rate, if it has a local APIC.  Then hands the timer
+   tick to the APIC timer if TIMER_FREQ is too high for the PIT,
+   or else uses it for sub-tick sleeps.  Interrupts must be on. */
+static void
+hires_calibrate (void) 
+{
+  uint64_t start_cycles, mult;
+  uint32_t lapic_counts = 0;
+  int64_t start;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (!tsc_present && !lapic_present ())
+    return;
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  /* Let both counters run for HIRES_CALIBRATE_TICKS ticks. */
+  start_cycles = timer_cycles ();
+  if (lapic_present ())
+    lapic_timer_start (UINT32_MAX, false);
+  start = ticks;
+  while (ticks - start < HIRES_CALIBRATE_TICKS)
+    barrier ();
+  if (lapic_present ()) 
+    {
+      lapic_counts = ((UINT32_MAX - lapic_timer_count ())
+                      / HIRES_CALIBRATE_TICKS);
+      lapic_timer_stop ();
+    }
+  if (tsc_present)
+    cycles_per_tick = ((timer_cycles () - start_cycles)
+                       / HIRES_CALIBRATE_TICKS);
+
+  if (cycles_per_tick != 0) 
+    {
+      /* Pick the largest ns_shift, up to 32, for which ns_mult =
+         NS_PER_TICK * 2**ns_shift / cycles_per_tick fits in 32
+         bits, for the most precise conversion that timer_now_ns()
+         can do without overflow. */
+      for (ns_shift = 32; ns_shift > 0; ns_shift--) 
+        {
+          mult = (((uint64_t) NS_PER_TICK << ns_shift) + cycles_per_tick / 2)
+                 / cycles_per_tick;
+          if (mult <= UINT32_MAX)
+            break;
+        }
+      ns_mult = mult;
+
+      /* Make timer_now_ns() agree with the tick count: the TSC
+         read START_CYCLES just as tick START began. */
+      boot_cycles = start_cycles - start * cycles_per_tick;
+      printf ("TSC: %'"PRIu64" cycles/s.\n", cycles_per_tick * TIMER_FREQ);
+    }
+
+  if (lapic_counts != 0) 
+    {
+      printf ("APIC timer: %'"PRIu64" counts/s.\n",
+              (uint64_t) lapic_counts * TIMER_FREQ);
+      ap_counts_per_tick = lapic_counts;
+      intr_register_ext (LAPIC_VEC_TICK, ap_tick_interrupt, "AP Timer");
+      if (TIMER_FREQ > TIMER_FREQ_PIT_MAX)
+        lapic_tick_start (lapic_counts);
+      else if (cycles_per_tick != 0) 
+        {
+          lapic_counts_per_tick = lapic_counts;
+          intr_register_ext (LAPIC_VEC_TIMER, hires_interrupt, "APIC Timer");
+        }
+    }
+}
+
+/* Hands the timer tick over from the PIT to the local APIC
+   timer, which counts down COUNTS times per tick. */
+static void
+lapic_tick_start (uint32_t counts) 
+{
+  enum intr_level old_level;
+
+  intr_register_ext (LAPIC_VEC_TIMER, timer_interrupt, "APIC Timer");
+
+  old_level = intr_disable ();
+  ASSERT (oneshot_ticks == 0);
+  lapic_tick = true;
+  counts_per_tick = counts;
+  lapic_timer_periodic (LAPIC_VEC_TIMER, counts_per_tick);
+
+  /* Put the PIT in one-shot mode, so that it interrupts only
+     once more, for timer_interrupt() to ignore. */
+  pit_start_oneshot (0, UINT16_MAX);
+  intr_set_level (old_level);
+
+  printf ("Timer: %d Hz from the local APIC timer.\n", TIMER_FREQ);
+}
+
+/* Starts the timer tick on an application processor.  Called by
+   the processor itself, with interrupts off, as it starts up. */
+void
+timer_init_ap (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (ap_counts_per_tick != 0);
+
+  lapic_timer_periodic (LAPIC_VEC_TICK, ap_counts_per_tick);
+}
+
+/* Timer interrupt handler for the application processors. */
+static void
+ap_tick_interrupt (struct intr_frame *args UNUSED) 
+{
+  thread_tick ();
+}
+
+/* Returns the number of counts left before the tick source next
+   interrupts. */
+static uint32_t
+tick_count (void) 
+{
+  return lapic_tick ? lapic_timer_count () : pit_read_count (0);
+}
+
+/* Returns the largest count the tick source can count down
+   from. */
+static uint32_t
+tick_count_max (void) 
+{
+  return lapic_tick ? UINT32_MAX : UINT16_MAX;
+}
+
+/* Returns true if the tick source's one-shot count has run out.
+   The APIC timer stops at 0, but the PIT wraps around and keeps
+   counting down, so a low count read from it does not show that
+   the count has not yet run out; its output does. */
+static bool
+tick_expired (void) 
+{
+  return lapic_tick ? lapic_timer_count () == 0 : pit_output (0);
+}
+
+/* Makes the tick source interrupt once, after COUNT counts. */
+static void
+tick_oneshot (uint32_t count) 
+{
+  if (lapic_tick)
+    lapic_timer_start (count, true);
+  else
+    pit_start_oneshot (0, count);
+}
+
+/* Makes the tick source interrupt TIMER_FREQ times per second. */
+static void
+tick_periodic (void) 
+{
+  if (lapic_tick)
+    lapic_timer_periodic (LAPIC_VEC_TIMER, counts_per_tick);
+  else
+    pit_configure_channel (0, 2, TIMER_FREQ);
+}
+
+/* Blocks the running thread for approximately NS nanoseconds,
+   which must be less than one timer tick.  Only the boot CPU's
+   APIC timer is free for sub-tick sleeps, so on any other CPU
+   this busy-waits instead. */
+static void
+hires_sleep (int64_t ns) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (lapic_counts_per_tick != 0);
+  ASSERT (ns > 0 && ns < NS_PER_TICK);
+
+  old_level = intr_disable ();
+  if (cpu_current () != &cpus[0]) 
+    {
+      intr_set_level (old_level);
+      real_time_delay (ns, 1000 * 1000 * 1000);
+      return;
+    }
+  cur->wakeup_cycles = timer_cycles () + ns * cycles_per_tick / NS_PER_TICK;
+  list_insert_ordered (&hires_list, &cur->elem, hires_less, NULL);
+  if (list_front (&hires_list) == &cur->elem)
+    hires_arm ();
+  thread_sleep ();
+  intr_set_level (old_level);
+}
+
+/* Starts the APIC timer so that it interrupts once the TSC
+   reaches the wake-up time of the first thread in hires_list.
+   Stops it if the list is empty. */
+static void
+hires_arm (void) 
+{
+  struct thread *t;
+  uint64_t now;
+  uint32_t count = 1;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&hires_list)) 
+    {
+      lapic_timer_stop ();
+      return;
+    }
+
+  /* Round up, so as never to interrupt early. */
+  t = list_entry (list_front (&hires_list), struct thread, elem);
+  now = timer_cycles ();
+  if (t->wakeup_cycles > now) 
+    {
+      uint64_t cycles = t->wakeup_cycles - now;
+      if (cycles > cycles_per_tick)
+        cycles = cycles_per_tick;
+      count = DIV_ROUND_UP (cycles * lapic_counts_per_tick, cycles_per_tick);
+      if (count == 0)
+        count = 1;
+    }
+  lapic_timer_start (count, true);
+}
+
+/* APIC timer interrupt handler.  Unblocks every thread in
+   hires_list whose wake-up time has passed, and rearms the timer
+   for the next one. */
+static void
+hires_interrupt (struct intr_frame *args UNUSED) 
+{
+  uint64_t now = timer_cycles ();
+  bool woke = false;
+
+  while (!list_empty (&hires_list)) 
+    {
+      struct thread *t = list_entry (list_front (&hires_list),
+                                     struct thread, elem);
+      if (t->wakeup_cycles > now)
+        break;
+      list_pop_front (&hires_list);
+      thread_unblock (t);
+      woke = true;
+    }
+  hires_arm ();
+
+  /* A thread that asked for a sub-tick sleep should not then
+     wait out the rest of another thread's time slice.  If the CPU
+     was idle, thread_unblock() has already arranged to preempt the
+     idle thread, and schedule() restarts the periodic tick as the
+     idle thread leaves the CPU. */
+  if (woke && thread_current () != cpus[0].idle_thread)
+    intr_yield_on_return ();
+}
+
+/* Returns true if thread A's sub-tick sleep ends before thread
+   B's. */
+static bool
+hires_less (const struct list_elem *a_, const struct list_elem *b_,
+            void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_cycles < b->wakeup_cycles;
+}
+
 /* Sleep for approximately NUM/DENOM seconds. */
 static void
 real_time_sleep (int64_t num, int32_t denom) 
@@ -244,9 +1084,15 @@ real_time_sleep (int64_t num, int32_t denom)
     }
   else 
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
-      real_time_delay (num, denom); 
+      /* Otherwise, block until the APIC timer interrupt if the
+         high-resolution timer is available and the wait is long
+         enough to be worth it, or use a busy-wait loop for more
+         accurate sub-tick timing. */
+      int64_t ns = num * (1000 * 1000 * 1000 / denom);
+      if (lapic_counts_per_tick != 0 && ns >= HIRES_MIN_NS)
+        hires_sleep (ns);
+      else
+        real_time_delay (num, denom); 
     }
 }
 
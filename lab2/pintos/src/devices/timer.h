@@ -2,28 +2,70 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-/* Number of timer interrupts per second. */
-#define TIMER_FREQ 100
+/* Number of timer interrupts per second, by default and at
+   most.  The 8254 PIT drives the timer at up to
+   TIMER_FREQ_PIT_MAX Hz, the local APIC timer at higher rates. */
+#define TIMER_FREQ_DEFAULT 100
+#define TIMER_FREQ_MIN 19
+#define TIMER_FREQ_PIT_MAX 1000
+#define TIMER_FREQ_MAX 10000
+
+/* Number of timer interrupts per second.
+   Controlled by kernel command-line option "-hz=N". */
+extern int timer_freq;
+#define TIMER_FREQ timer_freq
+
+/* If true, stop the periodic tick while idle.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
 
 void timer_init (void);
+void timer_init_ap (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_wakeup_events (void);
+int64_t timer_interrupt_cnt (void);
+
+/* High-resolution clock, safe in any context. */
+uint64_t timer_cycles (void);
+int64_t timer_now_ns (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
+void timer_sleep_until (int64_t deadline);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* A periodic timer.  A thread that calls timer_periodic_wait()
+   in a loop runs once every `period' ticks, on a fixed grid of
+   deadlines. */
+struct timer_periodic
+  {
+    int64_t period;             /* Ticks between deadlines. */
+    int64_t next;               /* Next deadline. */
+    int64_t overruns;           /* Deadlines skipped for lateness. */
+  };
+
+void timer_periodic_init (struct timer_periodic *, int64_t period,
+                          int64_t phase);
+int64_t timer_periodic_wait (struct timer_periodic *);
+
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Dynamic ticks, for the idle thread. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+void timer_account_yield (uint8_t vec_no, uint64_t cycles);
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,379 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* The algorithms follow [CLRS] chapter 13 "Red-Black Trees",
+   except that null pointers take the place of the sentinel leaf
+   nodes, so that deletion has to keep track of the parent of the
+   node that replaces the deleted one. */
+
+static void rotate_left (struct rbtree *, struct rb_elem *);
+static void rotate_right (struct rbtree *, struct rb_elem *);
+static void replace_child (struct rbtree *, struct rb_elem *parent,
+                           struct rb_elem *old, struct rb_elem *new);
+static void insert_fixup (struct rbtree *, struct rb_elem *);
+static void remove_fixup (struct rbtree *, struct rb_elem *parent,
+                          struct rb_elem *);
+
+/* Returns true if E is a red node.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rbtree *tree, rb_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = tree->min = NULL;
+  tree->elem_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts E into TREE.  E goes after any elements equal to it. */
+void
+rb_insert (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &tree->root;
+  bool leftmost = true;
+
+  ASSERT (e != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (e, parent, tree->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    tree->min = e;
+  tree->elem_cnt++;
+
+  insert_fixup (tree, e);
+}
+
+/* Removes E, which must be in TREE, from TREE. */
+void
+rb_remove (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *child, *parent;
+  bool red;
+
+  ASSERT (e != NULL);
+  ASSERT (tree->elem_cnt > 0);
+
+  if (tree->min == e)
+    tree->min = rb_next (e);
+  tree->elem_cnt--;
+
+  if (e->left != NULL && e->right != NULL)
+    {
+      /* E has two children.  Its successor, the least element of
+         its right subtree, has no left child: splice the
+         successor out of its place and put it in E's. */
+      struct rb_elem *next = e->right;
+      while (next->left != NULL)
+        next = next->left;
+
+      child = next->right;
+      parent = next->parent;
+      red = next->red;
+      if (child != NULL)
+        child->parent = parent;
+      replace_child (tree, parent, next, child);
+      if (next->parent == e)
+        parent = next;
+
+      next->parent = e->parent;
+      next->left = e->left;
+      next->right = e->right;
+      next->red = e->red;
+      replace_child (tree, e->parent, e, next);
+      e->left->parent = next;
+      if (e->right != NULL)
+        e->right->parent = next;
+    }
+  else
+    {
+      child = e->left != NULL ? e->left : e->right;
+      parent = e->parent;
+      red = e->red;
+      if (child != NULL)
+        child->parent = parent;
+      replace_child (tree, parent, e, child);
+    }
+
+  /* Removing a black node leaves one path short of a black node. */
+  if (!red)
+    remove_fixup (tree, parent, child);
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_min (const struct rbtree *tree)
+{
+  return tree->min;
+}
+
+/* Returns the greatest element in TREE, or a null pointer if
+   TREE is empty. */
+struct rb_elem *
+rb_max (const struct rbtree *tree)
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->right != NULL)
+      e = e->right;
+  return e;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest element. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element that precedes E in its tree, or a null
+   pointer if E is the least element. */
+struct rb_elem *
+rb_prev (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->left != NULL)
+    {
+      e = e->left;
+      while (e->right != NULL)
+        e = e->right;
+      return e;
+    }
+  while (e->parent != NULL && e == e->parent->left)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rbtree *tree)
+{
+  return tree->elem_cnt;
+}
+
+/* Returns true if TREE contains no elements, false otherwise. */
+bool
+rb_empty (const struct rbtree *tree)
+{
+  return tree->elem_cnt == 0;
+}
+
+/* Makes NEW take the place of OLD as a child of PARENT, or as
+   TREE's root if PARENT is a null pointer. */
+static void
+replace_child (struct rbtree *tree, struct rb_elem *parent,
+               struct rb_elem *old, struct rb_elem *new)
+{
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Rotates the subtree rooted at X to the left, making X's right
+   child its root. */
+static void
+rotate_left (struct rbtree *tree, struct rb_elem *x)
+{
+  struct rb_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  replace_child (tree, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, making X's left
+   child its root. */
+static void
+rotate_right (struct rbtree *tree, struct rb_elem *x)
+{
+  struct rb_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  replace_child (tree, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Restores the red-black properties after red node E has been
+   inserted into TREE. */
+static void
+insert_fixup (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *parent;
+
+  while ((parent = e->parent) != NULL && parent->red)
+    {
+      struct rb_elem *gparent = parent->parent;
+
+      if (parent == gparent->left)
+        {
+          struct rb_elem *uncle = gparent->right;
+          if (is_red (uncle))
+            {
+              uncle->red = parent->red = false;
+              gparent->red = true;
+              e = gparent;
+              continue;
+            }
+          if (e == parent->right)
+            {
+              rotate_left (tree, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          gparent->red = true;
+          rotate_right (tree, gparent);
+        }
+      else
+        {
+          struct rb_elem *uncle = gparent->left;
+          if (is_red (uncle))
+            {
+              uncle->red = parent->red = false;
+              gparent->red = true;
+              e = gparent;
+              continue;
+            }
+          if (e == parent->left)
+            {
+              rotate_right (tree, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          gparent->red = true;
+          rotate_left (tree, gparent);
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black node has been
+   removed from TREE.  E, possibly a null leaf, took the removed
+   node's place as a child of PARENT. */
+static void
+remove_fixup (struct rbtree *tree, struct rb_elem *parent,
+              struct rb_elem *e)
+{
+  while (!is_red (e) && e != tree->root)
+    {
+      struct rb_elem *sibling;
+
+      if (parent->left == e)
+        {
+          sibling = parent->right;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->right))
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (tree, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (tree, parent);
+              e = tree->root;
+            }
+        }
+      else
+        {
+          sibling = parent->left;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->left))
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (tree, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (tree, parent);
+              e = tree->root;
+            }
+        }
+    }
+  if (e != NULL)
+    e->red = false;
+}
@@ -0,0 +1,75 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a binary search tree that keeps itself
+   balanced, so that insertion, deletion, and search take
+   O(log n) time in the worst case.  This implementation keeps
+   the elements in the order given by a caller-supplied
+   comparison function, allows equal elements, which it keeps in
+   insertion order, and remembers the least element, so that
+   finding it takes constant time.
+
+   Like the linked list in list.h, the tree does not use dynamic
+   allocation.  Instead, each structure that can potentially be
+   in a tree must embed a struct rb_elem member, and rb_entry()
+   converts a struct rb_elem back to the structure object that
+   contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation of the technique. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null pointer at root. */
+    struct rb_elem *left;       /* Left child, or null pointer. */
+    struct rb_elem *right;      /* Right child, or null pointer. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rbtree
+  {
+    struct rb_elem *root;       /* Root, or null pointer if empty. */
+    struct rb_elem *min;        /* Least element, or null pointer. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+
+/* Insertion, deletion. */
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+
+/* Traversal, in ascending order. */
+struct rb_elem *rb_min (const struct rbtree *);
+struct rb_elem *rb_max (const struct rbtree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+/* Information. */
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,105 @@
+/* Measures the precision and CPU cost of sub-tick sleeps.
+
+   For each of several sleep lengths shorter than a timer tick,
+   calls timer_usleep() repeatedly, then does the same with
+   timer_udelay() for comparison, and reports the time requested,
+   the time that actually passed, and how much of the CPU a
+   background thread that just counts got meanwhile.  With the
+   high-resolution timer, sleeping threads yield the CPU, so the
+   counting thread should get nearly all of it; busy-waiting
+   leaves it only what round-robin scheduling hands out. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Microseconds of sleep requested in each round. */
+#define ROUND_US 200000
+
+/* Ticks over which the counting thread's full speed is
+   measured. */
+#define BASELINE_TICKS 20
+
+/* Shared with the counting thread. */
+static volatile int64_t counter;
+static volatile bool stop;
+static struct semaphore stopped;
+
+static void counting_thread (void *);
+static void measure (const char *name, void (*func) (int64_t), int64_t us,
+                     int64_t baseline);
+
+void
+test_alarm_hires (void) 
+{
+  static const int64_t lengths[] = {50, 200, 2000};
+  int64_t baseline, start;
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&stopped, 0);
+  thread_create ("counter", PRI_DEFAULT, counting_thread, NULL);
+
+  /* Count at full speed while the main thread sleeps. */
+  start = counter;
+  timer_sleep (BASELINE_TICKS);
+  baseline = (counter - start) / BASELINE_TICKS;
+  if (baseline == 0)
+    fail ("counting thread did not run");
+
+  for (i = 0; i < sizeof lengths / sizeof *lengths; i++) 
+    {
+      measure ("sleep", timer_usleep, lengths[i], baseline);
+      measure ("delay", timer_udelay, lengths[i], baseline);
+    }
+
+  stop = true;
+  sema_down (&stopped);
+  pass ();
+}
+
+/* Calls FUNC(US) enough times to wait ROUND_US microseconds in
+   all and reports the time it took and the share of the CPU the
+   counting thread got meanwhile, given that it counts BASELINE
+   times per tick when it has the CPU to itself. */
+static void
+measure (const char *name, void (*func) (int64_t), int64_t us,
+         int64_t baseline) 
+{
+  int64_t iterations = ROUND_US / us;
+  int64_t start, elapsed, count, share, i;
+
+  /* Start at a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    thread_yield ();
+
+  start = timer_ticks ();
+  count = counter;
+  for (i = 0; i < iterations; i++)
+    func (us);
+  elapsed = timer_elapsed (start);
+  count = counter - count;
+
+  share = elapsed > 0 ? count * 100 / (elapsed * baseline) : 0;
+  if (share > 100)
+    share = 100;
+  msg ("%s %"PRId64" us x %"PRId64": requested %d ms, actual %"PRId64" ms, "
+       "other thread got %"PRId64"%% of CPU",
+       name, us, iterations, ROUND_US / 1000,
+       elapsed * 1000 / TIMER_FREQ, share);
+}
+
+/* Counts as fast as it can until told to stop. */
+static void
+counting_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    counter++;
+  sema_up (&stopped);
+}
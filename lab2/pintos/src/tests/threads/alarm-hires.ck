@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $how ('sleep', 'delay') {
+    foreach my $us (50, 200, 2000) {
+	my ($line) = grep (/^\(alarm-hires\) $how $us us x \d+:/, @output);
+	fail "No result reported for $how of $us us.\n" if !defined $line;
+	my ($requested, $actual)
+	  = $line =~ /requested (\d+) ms, actual (\d+) ms/
+	  or fail "Malformed result for $how of $us us.\n";
+
+	# Measured in whole ticks, so allow one tick of slack.
+	fail "$how of $us us took $actual ms, less than $requested ms.\n"
+	  if $actual + 10 < $requested;
+    }
+}
+fail "Test did not pass.\n" if !grep (/^\(alarm-hires\) PASS$/, @output);
+pass;
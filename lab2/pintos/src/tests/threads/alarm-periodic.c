@@ -0,0 +1,62 @@
+/* Measures drift of periodic work over 10,000 periods.
+
+   A thread that wakes up every PERIOD ticks and then works for
+   WORK_US microseconds each time, longer than a tick, should
+   stay on a fixed grid of deadlines with timer_periodic_wait(),
+   whereas a loop of timer_sleep() calls loses the time spent
+   working on every iteration.  Run with -hz=1000. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of periods run with the periodic timer. */
+#define PERIODS 10000
+
+/* Number of periods run with timer_sleep(), for comparison. */
+#define SLEEP_PERIODS 100
+
+/* Ticks per period. */
+#define PERIOD 2
+
+/* Microseconds of work done in each period. */
+#define WORK_US 1500
+
+void
+test_alarm_periodic (void) 
+{
+  struct timer_periodic p;
+  int64_t start, now;
+  int i;
+
+  ASSERT (TIMER_FREQ == 1000);
+
+  /* On a fixed grid, the last wake-up is no later than the
+     first. */
+  timer_periodic_init (&p, PERIOD, 0);
+  start = p.next;
+  now = 0;
+  for (i = 0; i < PERIODS; i++) 
+    {
+      timer_periodic_wait (&p);
+      now = timer_ticks ();
+      timer_udelay (WORK_US);
+    }
+  msg ("periodic timer: %d periods, drift %"PRId64" ticks, "
+       "%"PRId64" overruns", PERIODS,
+       now - (start + (PERIODS - 1 + p.overruns) * PERIOD), p.overruns);
+
+  /* With relative sleeps, every period runs long. */
+  start = timer_ticks ();
+  for (i = 0; i < SLEEP_PERIODS; i++) 
+    {
+      timer_sleep (PERIOD);
+      now = timer_ticks ();
+      timer_udelay (WORK_US);
+    }
+  msg ("timer_sleep: %d periods, drift %"PRId64" ticks",
+       SLEEP_PERIODS, now - (start + SLEEP_PERIODS * PERIOD));
+  pass ();
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($line) = grep (/^\(alarm-periodic\) periodic timer:/, @output);
+fail "No result reported for periodic timer.\n" if !defined $line;
+my ($drift) = $line =~ /drift (-?\d+) ticks/
+  or fail "Malformed result for periodic timer.\n";
+fail "Periodic timer drifted by $drift ticks.\n" if $drift < 0 || $drift > 1;
+fail "No result reported for timer_sleep.\n"
+  if !grep (/^\(alarm-periodic\) timer_sleep: \d+ periods, drift -?\d+ ticks$/,
+	    @output);
+fail "Test did not pass.\n" if !grep (/^\(alarm-periodic\) PASS$/, @output);
+pass;
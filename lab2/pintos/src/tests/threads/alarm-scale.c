@@ -0,0 +1,105 @@
+/* Measures the cost of a timer tick as the number of sleeping
+   threads grows.
+
+   For each sleeper count, puts that many threads to sleep until
+   a common deadline and then counts how many iterations of a
+   busy loop the main thread completes per tick while they sleep.
+   Whatever time the timer interrupt takes out of each tick shows
+   up as lost iterations, so if waking sleepers only looks at the
+   threads that are due, the loop rate stays flat from 10 to 1000
+   sleepers. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of ticks over which each loop rate is measured. */
+#define MEASURE_TICKS 50
+
+/* Ticks allowed for the sleepers to go to sleep. */
+#define SETTLE_TICKS 10
+
+/* Information about the test. */
+struct scale_test 
+  {
+    int64_t wakeup;             /* Tick at which all sleepers wake. */
+    struct semaphore done;      /* Upped by each sleeper once awake. */
+  };
+
+static void sleeper (void *);
+static int64_t loops_per_tick (void);
+
+void
+test_alarm_scale (void) 
+{
+  static const int sleeper_cnts[] = {10, 100, 1000};
+  struct scale_test test;
+  int64_t baseline;
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&test.done, 0);
+  baseline = loops_per_tick ();
+  msg ("0 sleepers: %"PRId64" loops/tick", baseline);
+
+  for (i = 0; i < sizeof sleeper_cnts / sizeof *sleeper_cnts; i++) 
+    {
+      int cnt = sleeper_cnts[i];
+      int64_t loops;
+      int j;
+
+      test.wakeup = timer_ticks () + 200 + SETTLE_TICKS + MEASURE_TICKS;
+      for (j = 0; j < cnt; j++)
+        if (thread_create ("sleeper", PRI_DEFAULT, sleeper, &test)
+            == TID_ERROR)
+          fail ("couldn't create sleeper %d of %d", j, cnt);
+
+      /* Let every sleeper reach timer_sleep(). */
+      timer_sleep (SETTLE_TICKS);
+      if (timer_ticks () + MEASURE_TICKS + 1 >= test.wakeup)
+        fail ("starting %d sleepers took too long", cnt);
+
+      loops = loops_per_tick ();
+      msg ("%d sleepers: %"PRId64" loops/tick, %"PRId64"%% of baseline",
+           cnt, loops, loops * 100 / baseline);
+
+      /* Wait for all of them to wake up and exit. */
+      for (j = 0; j < cnt; j++)
+        sema_down (&test.done);
+    }
+  pass ();
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *test_) 
+{
+  struct scale_test *test = test_;
+
+  timer_sleep (test->wakeup - timer_ticks ());
+  sema_up (&test->done);
+}
+
+/* Returns the average number of busy-loop iterations the running
+   thread completes per timer tick over MEASURE_TICKS ticks. */
+static int64_t
+loops_per_tick (void) 
+{
+  int64_t start, loops;
+
+  /* Start at a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    barrier ();
+
+  start = timer_ticks ();
+  loops = 0;
+  while (timer_elapsed (start) < MEASURE_TICKS)
+    loops++;
+  return loops / MEASURE_TICKS;
+}
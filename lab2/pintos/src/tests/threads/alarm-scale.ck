@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $cnt (0, 10, 100, 1000) {
+    fail "No loop rate reported for $cnt sleepers.\n"
+      if !grep (/^\(alarm-scale\) $cnt sleepers: \d+ loops\/tick/, @output);
+}
+
+# The tick must cost about the same however many threads sleep, so
+# the loop rate must stay within 10% of the rate with no sleepers.
+my $min_pct = 90;
+foreach (@output) {
+    my ($cnt, $pct) = /^\(alarm-scale\) (\d+) sleepers: .*, (\d+)% of baseline/
+      or next;
+    fail "$cnt sleepers left only $pct% of the baseline loop rate, "
+      . "expected at least $min_pct%.\n"
+      if $pct < $min_pct;
+}
+fail "Test did not pass.\n" if !grep (/^\(alarm-scale\) PASS$/, @output);
+pass;
@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::alarm;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+# While every thread sleeps, the idle CPU should take far fewer
+# timer interrupts than ticks go by, and on waking the tick count
+# should have caught up with the time that passed.  A thread woken
+# out of idle by an interrupt other than the timer's must find the
+# periodic tick running again.
+my ($ticks, $interrupts, $advanced, $spun);
+foreach (@output) {
+    ($ticks, $interrupts) = ($1, $2)
+      if /^\(alarm-tickless\) Slept (\d+) ticks with (\d+) timer interrupts/;
+    fail "Woke $1 ticks late from an idle sleep.\n"
+      if /^\(alarm-tickless\) Woke (-?\d+) ticks late\.$/ && $1 != 0;
+    fail "Tick count is $1 ticks off the clock after an idle sleep.\n"
+      if /^\(alarm-tickless\) Clock and tick count differ by (\d+) ticks\.$/
+        && $1 > 1;
+    ($advanced, $spun) = ($1, $2)
+      if /^\(alarm-tickless\) Tick count advanced at least (\d+) in (\d+)/;
+}
+fail "No idle sleep reported.\n" if !defined $ticks;
+fail "Idle sleep of $ticks ticks took $interrupts timer interrupts.\n"
+  if $interrupts * 2 > $ticks;
+fail "No tick count reported after sub-tick sleeps.\n" if !defined $spun;
+fail "Tick count advanced only $advanced ticks in $spun after waking.\n"
+  if $advanced < $spun - 1;
+
+check_alarm (7);
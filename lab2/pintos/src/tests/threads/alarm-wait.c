@@ -2,6 +2,7 @@
    duration, M times.  Records the wake-up order and verifies
    that it is valid. */
 
+#include <inttypes.h>
 #include <stdio.h>
 #include "tests/threads/tests.h"
 #include "threads/init.h"
@@ -11,6 +12,8 @@
 #include "devices/timer.h"
 
 static void test_sleep (int thread_cnt, int iterations);
+static void test_idle_sleep (int64_t ticks);
+static void test_idle_wakeup (int64_t ticks);
 
 void
 test_alarm_single (void) 
@@ -23,6 +26,30 @@ test_alarm_multiple (void)
 {
   test_sleep (5, 7);
 }
+
+/* Same as alarm-multiple, but with the timer tick stopped
+   whenever the CPU is idle, which it is for most of the test.
+   Then checks that a long sleep with nothing else to run skips
+   timer interrupts and wakes with the tick count up to date, and
+   that the tick keeps running after an interrupt other than the
+   timer's wakes a thread on the idle CPU. */
+void
+test_alarm_tickless (void) 
+{
+  ASSERT (timer_tickless);
+  test_sleep (5, 7);
+  test_idle_sleep (100);
+  test_idle_wakeup (3);
+}
+
+/* Same as alarm-multiple, but with the timer interrupting 4,000
+   times per second, which the local APIC timer drives. */
+void
+test_alarm_4khz (void) 
+{
+  ASSERT (TIMER_FREQ == 4000);
+  test_sleep (5, 7);
+}
 
 /* Information about the test. */
 struct sleep_test 
@@ -150,3 +177,72 @@ sleeper (void *t_)
       lock_release (&test->output_lock);
     }
 }
+
+/* Sleeps for TICKS ticks with no other thread to run, so that
+   the CPU idles throughout.  Reports how many timer interrupts
+   occurred meanwhile, how late the wake-up was, and how far the
+   tick count and the high-resolution clock disagree about the
+   time slept. */
+static void
+test_idle_sleep (int64_t ticks) 
+{
+  int64_t old_slack = thread_get_timer_slack ();
+  int64_t start, interrupts, start_ns, elapsed, elapsed_ns, drift;
+
+  msg ("Sleeping %"PRId64" ticks with the CPU idle.", ticks);
+  thread_set_timer_slack (0);
+
+  /* Start on a tick boundary. */
+  timer_sleep (1);
+  start = timer_ticks ();
+  start_ns = timer_now_ns ();
+  interrupts = timer_interrupt_cnt ();
+
+  timer_sleep (ticks);
+
+  elapsed = timer_elapsed (start);
+  elapsed_ns = timer_now_ns () - start_ns;
+  interrupts = timer_interrupt_cnt () - interrupts;
+  thread_set_timer_slack (old_slack);
+
+  drift = elapsed_ns * TIMER_FREQ / 1000000000 - elapsed;
+  msg ("Slept %"PRId64" ticks with %"PRId64" timer interrupts.",
+       elapsed, interrupts);
+  msg ("Woke %"PRId64" ticks late.", elapsed - ticks);
+  msg ("Clock and tick count differ by %"PRId64" ticks.",
+       drift < 0 ? -drift : drift);
+}
+
+/* Has the main thread, with nothing else to run, take a sub-tick
+   sleep, which the local APIC timer ends while the CPU idles with
+   the periodic tick stopped.  The woken thread then busy-waits
+   for TICKS ticks by the high-resolution clock and reports how far
+   the tick count advanced meanwhile, the fewest of several tries.
+   If the tick did not restart when the idle thread was preempted,
+   the count stands still until the one-shot interrupt fires. */
+static void
+test_idle_wakeup (int64_t ticks) 
+{
+  int64_t spin_ns = ticks * 1000000000 / TIMER_FREQ;
+  int64_t fewest = INT64_MAX;
+  int i;
+
+  msg ("Spinning %"PRId64" ticks after each of 5 sub-tick sleeps.", ticks);
+  for (i = 0; i < 5; i++) 
+    {
+      int64_t start, start_ns, elapsed;
+
+      timer_sleep (1);
+      timer_usleep (500);
+
+      start = timer_ticks ();
+      start_ns = timer_now_ns ();
+      while (timer_now_ns () - start_ns < spin_ns)
+        continue;
+      elapsed = timer_elapsed (start);
+      if (elapsed < fewest)
+        fewest = elapsed;
+    }
+  msg ("Tick count advanced at least %"PRId64" in %"PRId64" ticks.",
+       fewest, ticks);
+}
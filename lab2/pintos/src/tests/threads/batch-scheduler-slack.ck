@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (%events);
+foreach my $slack (0, 10) {
+    my ($line) = grep (/^\(batch-scheduler-slack\) slack $slack:/, @output);
+    fail "No result reported for slack $slack.\n" if !defined $line;
+    ($events{$slack}) = $line =~ /: (\d+) wakeup events, \d+ context switches$/
+      or fail "Malformed result for slack $slack.\n";
+}
+fail "Timer slack did not reduce wakeup events.\n"
+  if $events{10} >= $events{0};
+fail "Test did not pass.\n"
+  if !grep (/^\(batch-scheduler-slack\) PASS$/, @output);
+pass;
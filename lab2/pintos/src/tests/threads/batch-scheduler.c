@@ -1,15 +1,22 @@
 /* Tests cetegorical mutual exclusion with different numbers of threads.
  * Automatic checks only catch severe problems like crashes.
  */
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include "tests/threads/tests.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
 #include "devices/batch-scheduler.c"
 
+/* Timer slack given to the tasks in the slack run, in ticks. */
+#define TASK_SLACK 10
 
+static void run_tasks (int64_t slack);
+static void count_task (struct thread *, void *);
 
 void test_batch_scheduler(void)
 {
@@ -31,3 +38,56 @@ void test_batch_scheduler(void)
     batchScheduler(0, 10, 10, 0);
     pass();
 }
+
+/* Runs the same tasks without and with timer slack and reports
+ * how many wakeup events and context switches the slack saves.
+ */
+void test_batch_scheduler_slack(void)
+{
+    run_tasks(0);
+    run_tasks(TASK_SLACK);
+    pass();
+}
+
+/* Runs a batch of tasks with the given timer SLACK, waits for
+ * them all to finish, and reports the wakeup events and context
+ * switches they caused.
+ */
+static void run_tasks(int64_t slack)
+{
+    int64_t events = timer_wakeup_events();
+    long long switches = thread_context_switches();
+    int64_t old_slack = thread_get_timer_slack();
+    int tasks;
+
+    /* Tasks inherit the slack of the thread that creates them. */
+    init_bus();
+    thread_set_timer_slack(slack);
+    batchScheduler(22, 22, 10, 10);
+    thread_set_timer_slack(old_slack);
+
+    do
+      {
+        enum intr_level old_level;
+
+        timer_sleep(100);
+        tasks = 0;
+        old_level = intr_disable();
+        thread_foreach(count_task, &tasks);
+        intr_set_level(old_level);
+      }
+    while (tasks > 0);
+
+    msg("slack %"PRId64": %"PRId64" wakeup events, %lld context switches",
+        slack, timer_wakeup_events() - events,
+        thread_context_switches() - switches);
+}
+
+/* Adds 1 to *TASKS_ if T is one of the bus tasks. */
+static void count_task(struct thread *t, void *tasks_)
+{
+    int *tasks = tasks_;
+
+    if (strstr(t->name, "_task") != NULL)
+        (*tasks)++;
+}
@@ -0,0 +1,98 @@
+/* Checks that, under the CFS, CPU-bound threads of different nice
+   values share the CPU in proportion to their weights.
+
+   Runs one thread each at nice 0, 5, and 10 for SPIN_SECONDS,
+   while the main thread sleeps, and counts how many times each
+   goes around a loop.  By the weights in thread.c, the threads
+   should get 69.7%, 22.8%, and 7.5% of the CPU.  This test
+   assumes a single CPU. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Seconds for which the threads spin. */
+#define SPIN_SECONDS 5
+
+/* Largest error allowed in each share, in tenths of a percent. */
+#define MAX_ERROR 30
+
+/* Number of spinning threads. */
+#define SPINNERS 3
+
+struct spinner 
+  {
+    int nice;                   /* Nice value. */
+    int expected;               /* Expected share, in tenths of %. */
+    int64_t loops;              /* Times around the loop. */
+  };
+
+static thread_func spin_thread;
+
+static volatile bool stop;
+static struct semaphore done;
+
+void
+test_cfs_share (void) 
+{
+  static struct spinner spinners[SPINNERS] = 
+    {
+      {0, 697, 0},
+      {5, 228, 0},
+      {10, 75, 0},
+    };
+  int64_t total = 0;
+  int i;
+
+  ASSERT (thread_cfs);
+  ASSERT (cpu_cnt == 1);
+
+  sema_init (&done, 0);
+  msg ("Spinning for %d seconds at nice 0, 5, and 10...", SPIN_SECONDS);
+  for (i = 0; i < SPINNERS; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "nice %d", spinners[i].nice);
+      thread_create (name, PRI_DEFAULT, spin_thread, &spinners[i]);
+    }
+  timer_sleep (SPIN_SECONDS * TIMER_FREQ);
+  stop = true;
+  for (i = 0; i < SPINNERS; i++)
+    sema_down (&done);
+
+  for (i = 0; i < SPINNERS; i++)
+    total += spinners[i].loops;
+  for (i = 0; i < SPINNERS; i++) 
+    {
+      struct spinner *s = &spinners[i];
+      int share = s->loops * 1000 / total;
+      int error = share - s->expected;
+
+      msg ("nice %d: %d.%d%% of the CPU, expected %d.%d%%.",
+           s->nice, share / 10, share % 10,
+           s->expected / 10, s->expected % 10);
+      if (error > MAX_ERROR || error < -MAX_ERROR)
+        fail ("nice %d got %d.%d%% of the CPU, expected %d.%d%%",
+              s->nice, share / 10, share % 10,
+              s->expected / 10, s->expected % 10);
+    }
+  pass ();
+}
+
+/* Spinning thread.  Sets its nice value and counts loops until
+   told to stop. */
+static void
+spin_thread (void *s_) 
+{
+  struct spinner *s = s_;
+
+  thread_set_nice (s->nice);
+  while (!stop)
+    s->loops++;
+  sema_up (&done);
+}
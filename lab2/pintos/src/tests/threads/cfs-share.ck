@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $nice (0, 5, 10) {
+    fail "No CPU share reported for nice $nice.\n"
+      if !grep (/^\(cfs-share\) nice $nice: \d+\.\d% of the CPU/, @output);
+}
+fail "Test did not pass.\n" if !grep (/^\(cfs-share\) PASS$/, @output);
+pass;
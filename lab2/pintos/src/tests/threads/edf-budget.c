@@ -0,0 +1,126 @@
+/* Checks the EDF class's admission control and budget
+   enforcement.
+
+   Two EDF threads each reserve 3 ticks of every 10, along with a
+   thread outside the EDF class that spins.  One EDF thread does
+   its little work and waits for its next period, and should meet
+   every deadline.  The other spins without ever finishing a job,
+   so it should be throttled to 30% of the CPU and miss nearly
+   every deadline, leaving the rest to the spinning thread.  With
+   60% of the CPU reserved, the main thread's request for 40% more
+   should be refused.  This test assumes a single CPU. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Period, runtime, and deadline of the EDF threads. */
+#define PERIOD 10
+#define RUNTIME 3
+#define DEADLINE 10
+
+/* Number of periods for which the test runs. */
+#define PERIODS 50
+
+/* Largest error allowed in the overrunning thread's share, in
+   tenths of a percent. */
+#define MAX_ERROR 50
+
+static thread_func periodic_thread;
+static thread_func overrun_thread;
+static thread_func hog_thread;
+
+static volatile bool stop;
+static struct semaphore started, done;
+
+static int periodic_misses;
+static int overrun_misses;
+static int64_t overrun_loops, hog_loops;
+
+void
+test_edf_budget (void) 
+{
+  int share;
+
+  ASSERT (cpu_cnt == 1);
+
+  sema_init (&started, 0);
+  sema_init (&done, 0);
+  thread_create ("hog", PRI_DEFAULT, hog_thread, NULL);
+  thread_create ("periodic", PRI_DEFAULT, periodic_thread, NULL);
+  thread_create ("overrun", PRI_DEFAULT, overrun_thread, NULL);
+  sema_down (&started);
+  sema_down (&started);
+
+  msg ("Reserving 40% more of the CPU should fail.");
+  if (thread_set_deadline (PERIOD, 4, DEADLINE))
+    fail ("admitted more than the CPU can take");
+
+  timer_sleep (PERIODS * PERIOD);
+  stop = true;
+  sema_down (&done);
+  sema_down (&done);
+  sema_down (&done);
+
+  msg ("periodic thread missed %d deadlines.", periodic_misses);
+  if (periodic_misses != 0)
+    fail ("periodic thread missed deadlines");
+
+  msg ("overrun thread missed %d deadlines.", overrun_misses);
+  if (overrun_misses < PERIODS - 5)
+    fail ("overrun thread missed only %d of %d deadlines",
+          overrun_misses, PERIODS);
+
+  share = overrun_loops * 1000 / (overrun_loops + hog_loops);
+  msg ("overrun thread got %d.%d%% of the spinning.",
+       share / 10, share % 10);
+  if (share > RUNTIME * 1000 / PERIOD + MAX_ERROR
+      || share < RUNTIME * 1000 / PERIOD - MAX_ERROR)
+    fail ("overrun thread got %d.%d%%, expected %d%%",
+          share / 10, share % 10, RUNTIME * 100 / PERIOD);
+  pass ();
+}
+
+/* EDF thread that finishes each job at once. */
+static void
+periodic_thread (void *aux UNUSED) 
+{
+  bool ok = thread_set_deadline (PERIOD, RUNTIME, DEADLINE);
+  sema_up (&started);
+  if (!ok)
+    fail ("periodic thread not admitted");
+
+  while (!stop)
+    thread_wait_period ();
+  periodic_misses = thread_get_deadline_misses ();
+  sema_up (&done);
+}
+
+/* EDF thread that never finishes its job. */
+static void
+overrun_thread (void *aux UNUSED) 
+{
+  bool ok = thread_set_deadline (PERIOD, RUNTIME, DEADLINE);
+  sema_up (&started);
+  if (!ok)
+    fail ("overrun thread not admitted");
+
+  while (!stop)
+    overrun_loops++;
+  overrun_misses = thread_get_deadline_misses ();
+  sema_up (&done);
+}
+
+/* Thread outside the EDF class that spins. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    hog_loops++;
+  sema_up (&done);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Periodic thread's misses not reported.\n"
+  if !grep (/^periodic: missed 0 of \d+ deadlines$/, @output);
+fail "Overrun thread's misses not reported.\n"
+  if !grep (/^overrun: missed \d+ of \d+ deadlines$/, @output);
+fail "Test did not pass.\n" if !grep (/^\(edf-budget\) PASS$/, @output);
+pass;
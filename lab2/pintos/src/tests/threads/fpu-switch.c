@@ -0,0 +1,89 @@
+/* Checks that each thread keeps its own FPU and SSE registers.
+
+   Starts THREAD_CNT threads that each load a value of their own
+   into an SSE register and the x87 register stack, inside
+   fpu_begin() and fpu_end(), and then yield and sleep many times,
+   so that the others run in between and change the registers,
+   and checks that the values survive. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/fpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of threads. */
+#define THREAD_CNT 4
+
+/* Number of times each thread gives up the CPU. */
+#define ROUNDS 100
+
+static thread_func fpu_thread;
+
+static struct semaphore done;
+static int errors;
+
+void
+test_fpu_switch (void) 
+{
+  int i;
+
+  if (!fpu_available ()) 
+    {
+      msg ("CPU lacks FXSAVE and SSE.");
+      return;
+    }
+
+  sema_init (&done, 0);
+  errors = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "fpu %d", i);
+      thread_create (name, PRI_DEFAULT, fpu_thread, (void *) (i + 1));
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  if (errors != 0)
+    fail ("%d threads' registers lost their values", errors);
+  msg ("%d threads kept their FPU and SSE registers.", THREAD_CNT);
+}
+
+/* Loads a value based on ID_ into XMM7 and ST(0), then checks
+   that they keep it as other threads run. */
+static void
+fpu_thread (void *id_) 
+{
+  int id = (int) id_;
+  int value = id * 1000;
+  int xmm[4] = {value, value + 1, value + 2, value + 3};
+  int i;
+
+  fpu_begin ();
+  asm volatile ("movups %0, %%xmm7; fildl %1" : : "m" (xmm), "m" (value));
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      int check[4];
+      int st0;
+
+      if (i % 10 == 0)
+        timer_sleep (1);
+      else
+        thread_yield ();
+
+      asm volatile ("movups %%xmm7, %0; fistl %1"
+                    : "=m" (check), "=m" (st0));
+      if (check[0] != value || check[3] != value + 3 || st0 != value) 
+        {
+          errors++;
+          break;
+        }
+    }
+  asm volatile ("fstp %st(0)");
+  fpu_end ();
+
+  sema_up (&done);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(fpu-switch) begin
+(fpu-switch) 4 threads kept their FPU and SSE registers.
+(fpu-switch) end
+EOF
+(fpu-switch) begin
+(fpu-switch) CPU lacks FXSAVE and SSE.
+(fpu-switch) end
+EOF
+pass;
@@ -0,0 +1,136 @@
+/* Measures the round-trip latency of a pair of threads that take
+   turns through a pair of semaphores, as in sema_self_test(),
+   with 0, 10, and 100 other threads ready to run, first without
+   and then with handoffs (see thread_hand_off()).
+
+   Without handoffs, each thread woken goes to the back of the
+   run queue, behind every busy thread, so that a round trip
+   takes longer and longer as busy threads are added.  With them,
+   the woken thread runs at once for the rest of the waker's time
+   slice, and only the end of a time slice sends the pair to the
+   back of the queue. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* How long each measurement lasts, in seconds. */
+#define SECONDS 1
+
+/* Most busy threads. */
+#define BUSY_MAX 100
+
+static thread_func ping_thread, pong_thread, busy_thread;
+
+struct ping_pong 
+  {
+    struct semaphore ping, pong;        /* Ping and pong go-aheads. */
+    struct semaphore done;              /* Upped by each thread at end. */
+    volatile bool stop;                 /* Time to stop? */
+    int64_t round_trips;                /* # of round trips. */
+    int64_t elapsed;                    /* Time taken, in ns. */
+  };
+
+static void measure (int busy_cnt, bool handoff);
+
+void
+test_handoff_pingpong (void) 
+{
+  static const int busy_cnts[] = {0, 10, 100};
+  bool handoff = thread_handoff;
+  size_t i;
+
+  ASSERT (!thread_mlfqs && !thread_cfs && !thread_stride);
+
+  for (i = 0; i < sizeof busy_cnts / sizeof *busy_cnts; i++)
+    measure (busy_cnts[i], false);
+  for (i = 0; i < sizeof busy_cnts / sizeof *busy_cnts; i++)
+    measure (busy_cnts[i], true);
+  thread_handoff = handoff;
+  pass ();
+}
+
+/* Runs the pair of threads for SECONDS seconds with BUSY_CNT busy
+   threads, with handoffs if HANDOFF is true, and reports the
+   mean round-trip time. */
+static void
+measure (int busy_cnt, bool handoff) 
+{
+  struct ping_pong pp;
+  int i;
+
+  ASSERT (busy_cnt <= BUSY_MAX);
+
+  thread_handoff = handoff;
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  sema_init (&pp.done, 0);
+  pp.stop = false;
+  pp.round_trips = 0;
+
+  for (i = 0; i < busy_cnt; i++)
+    if (thread_create ("busy", PRI_DEFAULT, busy_thread, &pp) == TID_ERROR)
+      fail ("thread_create failed for busy thread %d", i);
+  thread_create ("pong", PRI_DEFAULT, pong_thread, &pp);
+  thread_create ("ping", PRI_DEFAULT, ping_thread, &pp);
+  for (i = 0; i < busy_cnt + 2; i++)
+    sema_down (&pp.done);
+
+  msg ("%d busy threads, handoff %s: %"PRId64" round trips, "
+       "%"PRId64" ns each.", busy_cnt, handoff ? "on" : "off",
+       pp.round_trips,
+       pp.round_trips > 0 ? pp.elapsed / pp.round_trips : 0);
+}
+
+/* Starts each round trip and waits for its end, until SECONDS
+   seconds have passed, then tells the other threads to stop. */
+static void
+ping_thread (void *pp_) 
+{
+  struct ping_pong *pp = pp_;
+  int64_t start = timer_now_ns ();
+  int64_t end = timer_ticks () + SECONDS * TIMER_FREQ;
+
+  while (timer_ticks () < end) 
+    {
+      sema_up (&pp->ping);
+      sema_down (&pp->pong);
+      pp->round_trips++;
+    }
+  pp->elapsed = timer_now_ns () - start;
+
+  pp->stop = true;
+  sema_up (&pp->ping);
+  sema_up (&pp->done);
+}
+
+/* Answers each ping with a pong, until told to stop. */
+static void
+pong_thread (void *pp_) 
+{
+  struct ping_pong *pp = pp_;
+
+  for (;;) 
+    {
+      sema_down (&pp->ping);
+      if (pp->stop)
+        break;
+      sema_up (&pp->pong);
+    }
+  sema_up (&pp->done);
+}
+
+/* Keeps the CPU busy until told to stop. */
+static void
+busy_thread (void *pp_) 
+{
+  struct ping_pong *pp = pp_;
+
+  while (!pp->stop)
+    continue;
+  sema_up (&pp->done);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $handoff ('off', 'on') {
+    foreach my $busy (0, 10, 100) {
+	fail "Round trips with $busy busy threads, handoff $handoff, "
+	  . "not reported.\n"
+	  if !grep (/^\(handoff-pingpong\) $busy busy threads, handoff $handoff: \d+ round trips, \d+ ns each\.$/,
+		    @output);
+    }
+}
+fail "Test did not pass.\n"
+  if !grep (/^\(handoff-pingpong\) PASS$/, @output);
+pass;
@@ -0,0 +1,115 @@
+/* Checks that the scheduler's once-a-second work does not grow
+   with the number of blocked threads.
+
+   Blocks THREAD_CNT threads on a semaphore and keeps BUSY_CNT
+   threads busy for a few seconds under the MLFQS, whose update
+   every second used to visit every thread with interrupts off,
+   and reports the longest time interrupts were off meanwhile.
+   Also checks that the blocked threads are all in the blocked
+   set and that thread_lookup() finds each of them by tid. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of blocked threads. */
+#define THREAD_CNT 500
+
+/* Number of busy threads. */
+#define BUSY_CNT 2
+
+/* How long the busy threads run, in seconds. */
+#define SECONDS 5
+
+static thread_func blocked_thread, busy_thread;
+static thread_action_func count_thread;
+
+static struct semaphore wakeup, done;
+static tid_t tids[THREAD_CNT];
+
+void
+test_mlfqs_blocked (void) 
+{
+  enum intr_level old_level;
+  uint64_t max;
+  int64_t end;
+  int blocked, found;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&wakeup, 0);
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      tids[i] = thread_create ("blocked", PRI_DEFAULT, blocked_thread, NULL);
+      if (tids[i] == TID_ERROR)
+        fail ("thread_create failed for thread %d", i);
+    }
+  timer_msleep (100);
+
+  old_level = intr_disable ();
+  blocked = 0;
+  thread_foreach_in (THREADS_BLOCKED, count_thread, &blocked);
+  found = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct thread *t = thread_lookup (tids[i]);
+      if (t != NULL && t->tid == tids[i] && t->set == THREADS_BLOCKED)
+        found++;
+    }
+  intr_set_level (old_level);
+  msg ("%d of %d threads blocked.", blocked, THREAD_CNT);
+  msg ("%d of %d threads found by tid.", found, THREAD_CNT);
+
+  end = timer_ticks () + SECONDS * TIMER_FREQ;
+  intr_off_reset ();
+  for (i = 0; i < BUSY_CNT; i++)
+    thread_create ("busy", PRI_DEFAULT, busy_thread, &end);
+  for (i = 0; i < BUSY_CNT; i++)
+    sema_down (&done);
+  max = intr_off_max ();
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&wakeup);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  msg ("Interrupts off for at most %"PRIu64" cycles.", max);
+  pass ();
+}
+
+/* Waits to be woken up, then signals that it is done. */
+static void
+blocked_thread (void *aux UNUSED) 
+{
+  sema_down (&wakeup);
+  sema_up (&done);
+}
+
+/* Spins until the tick *END, then signals that it is done. */
+static void
+busy_thread (void *end_) 
+{
+  const int64_t *end = end_;
+
+  while (timer_ticks () < *end)
+    continue;
+  sema_up (&done);
+}
+
+/* Adds 1 to *COUNT for thread T, if it is a blocked thread. */
+static void
+count_thread (struct thread *t, void *count_) 
+{
+  int *count = count_;
+
+  if (!strcmp (t->name, "blocked"))
+    (*count)++;
+}
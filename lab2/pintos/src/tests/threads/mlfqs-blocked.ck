@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Not all threads blocked.\n"
+  if !grep (/^\(mlfqs-blocked\) 500 of 500 threads blocked\.$/, @output);
+fail "Not all threads found by tid.\n"
+  if !grep (/^\(mlfqs-blocked\) 500 of 500 threads found by tid\.$/,
+	    @output);
+fail "Interrupts-off time not reported.\n"
+  if !grep (/^\(mlfqs-blocked\) Interrupts off for at most \d+ cycles\.$/,
+	    @output);
+fail "Test did not pass.\n" if !grep (/^\(mlfqs-blocked\) PASS$/, @output);
+pass;
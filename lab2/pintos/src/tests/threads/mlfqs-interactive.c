@@ -0,0 +1,83 @@
+/* Checks that, under the MLFQS, a thread that sleeps most of the
+   time gets the CPU as soon as it wakes up, even though several
+   CPU-bound threads of the same nice value are ready to run.
+
+   The CPU-bound threads' recent_cpu, and so their priorities,
+   soon fall well below the interactive thread's.  With plain
+   round-robin at equal priorities, the interactive thread would
+   have to wait for each of them to use up its time slice. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of CPU-bound threads. */
+#define SPINNERS 4
+
+/* Seconds for which the CPU-bound threads spin. */
+#define SPIN_SECONDS 10
+
+/* Number of times the interactive thread sleeps. */
+#define SLEEPS 500
+
+/* Largest wakeup delay allowed, in ticks. */
+#define MAX_DELAY 1
+
+static thread_func spin_thread;
+
+void
+test_mlfqs_interactive (void) 
+{
+  int64_t start_time, worst = 0;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d CPU-bound threads...", SPINNERS);
+  for (i = 0; i < SPINNERS; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "spin %d", i);
+      thread_create (name, PRI_DEFAULT, spin_thread, &start_time);
+    }
+
+  /* Give the CPU-bound threads a second to build up
+     recent_cpu. */
+  timer_sleep (TIMER_FREQ);
+
+  msg ("Sleeping %d times, one tick at a time...", SLEEPS);
+  for (i = 0; i < SLEEPS; i++) 
+    {
+      int64_t deadline = timer_ticks () + 1;
+      int64_t delay;
+
+      timer_sleep_until (deadline);
+      delay = timer_ticks () - deadline;
+      if (delay > worst)
+        worst = delay;
+    }
+
+  if (worst > MAX_DELAY)
+    fail ("worst wakeup delay was %"PRId64" ticks, more than %d",
+          worst, MAX_DELAY);
+  msg ("Worst wakeup delay was at most %d tick.", MAX_DELAY);
+
+  /* Wait for the CPU-bound threads to finish. */
+  timer_sleep_until (start_time + SPIN_SECONDS * TIMER_FREQ + TIMER_FREQ);
+  pass ();
+}
+
+/* Spins until SPIN_SECONDS seconds after *START_TIME_. */
+static void
+spin_thread (void *start_time_) 
+{
+  int64_t *start_time = start_time_;
+  int64_t end = *start_time + SPIN_SECONDS * TIMER_FREQ;
+
+  while (timer_ticks () < end)
+    continue;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-interactive) begin
+(mlfqs-interactive) Starting 4 CPU-bound threads...
+(mlfqs-interactive) Sleeping 500 times, one tick at a time...
+(mlfqs-interactive) Worst wakeup delay was at most 1 tick.
+(mlfqs-interactive) PASS
+(mlfqs-interactive) end
+EOF
+pass;
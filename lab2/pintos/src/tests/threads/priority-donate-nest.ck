@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-nest) begin
+(priority-donate-nest) Main thread should have priority 32.  Actual priority: 32.
+(priority-donate-nest) Main thread should have priority 33.  Actual priority: 33.
+(priority-donate-nest) Medium thread should have priority 33.  Actual priority: 33.
+(priority-donate-nest) Medium thread got the lock.
+(priority-donate-nest) High thread got the lock.
+(priority-donate-nest) High thread finished.
+(priority-donate-nest) High thread should have just finished.
+(priority-donate-nest) Medium thread finished.
+(priority-donate-nest) Medium thread should just have finished.
+(priority-donate-nest) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-nest) end
+EOF
+pass;
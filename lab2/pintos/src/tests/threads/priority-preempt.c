@@ -0,0 +1,81 @@
+/* Checks that a thread preempts the running thread as soon as it
+   becomes ready with a higher priority: on creation, on waking
+   from a semaphore, and when the running thread lowers its own
+   priority below it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func simple_thread;
+static thread_func waiting_thread;
+static thread_func lowering_thread;
+
+void
+test_priority_preempt (void) 
+{
+  struct semaphore sema;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  thread_create ("high", PRI_DEFAULT + 1, simple_thread, NULL);
+  msg ("The high-priority thread should have already completed.");
+
+  thread_create ("low", PRI_DEFAULT - 1, simple_thread, NULL);
+  msg ("The low-priority thread should not have run yet.");
+
+  sema_init (&sema, 0);
+  thread_create ("waiter", PRI_DEFAULT + 1, waiting_thread, &sema);
+  msg ("Waking the waiting thread.");
+  sema_up (&sema);
+  msg ("The waiting thread should have already completed.");
+
+  thread_create ("lowering", PRI_DEFAULT + 2, lowering_thread, NULL);
+  msg ("The lowering thread should have lowered its priority.");
+
+  /* Let the low-priority thread run. */
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+  pass ();
+}
+
+/* Yields a few times, to show that lower-priority threads do not
+   get to run meanwhile. */
+static void 
+simple_thread (void *aux UNUSED) 
+{
+  int i;
+  
+  for (i = 0; i < 3; i++) 
+    {
+      msg ("Thread %s iteration %d", thread_name (), i);
+      thread_yield ();
+    }
+  msg ("Thread %s done!", thread_name ());
+}
+
+/* Waits on semaphore SEMA_. */
+static void
+waiting_thread (void *sema_) 
+{
+  struct semaphore *sema = sema_;
+
+  msg ("Thread %s waiting.", thread_name ());
+  sema_down (sema);
+  msg ("Thread %s woke up.", thread_name ());
+}
+
+/* Lowers its priority below the main thread's, then back up. */
+static void
+lowering_thread (void *aux UNUSED) 
+{
+  msg ("Thread %s lowering its priority.", thread_name ());
+  thread_set_priority (PRI_DEFAULT - 1);
+  msg ("Thread %s done!", thread_name ());
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-preempt) begin
+(priority-preempt) Thread high iteration 0
+(priority-preempt) Thread high iteration 1
+(priority-preempt) Thread high iteration 2
+(priority-preempt) Thread high done!
+(priority-preempt) The high-priority thread should have already completed.
+(priority-preempt) The low-priority thread should not have run yet.
+(priority-preempt) Thread waiter waiting.
+(priority-preempt) Waking the waiting thread.
+(priority-preempt) Thread waiter woke up.
+(priority-preempt) The waiting thread should have already completed.
+(priority-preempt) Thread lowering lowering its priority.
+(priority-preempt) The lowering thread should have lowered its priority.
+(priority-preempt) Thread low iteration 0
+(priority-preempt) Thread lowering done!
+(priority-preempt) Thread low iteration 1
+(priority-preempt) Thread low iteration 2
+(priority-preempt) Thread low done!
+(priority-preempt) PASS
+(priority-preempt) end
+EOF
+pass;
@@ -0,0 +1,88 @@
+/* Measures the cost of scheduling as the number of ready threads
+   grows.
+
+   For each thread count, creates that many threads at a lower
+   priority than the main thread, so that they stay ready but
+   never run, and then counts how many times per tick the main
+   thread can yield.  Each yield has to find the highest-priority
+   ready thread, which is the main thread itself, so if that
+   takes constant time the yield rate stays flat from 10 to 1000
+   ready threads. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of ticks over which each yield rate is measured. */
+#define MEASURE_TICKS 50
+
+static thread_func ready_thread;
+static int64_t yields_per_tick (void);
+
+void
+test_priority_scale (void) 
+{
+  static const int thread_cnts[] = {10, 100, 1000};
+  int64_t baseline;
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  baseline = yields_per_tick ();
+  msg ("0 ready threads: %"PRId64" yields/tick", baseline);
+
+  for (i = 0; i < sizeof thread_cnts / sizeof *thread_cnts; i++) 
+    {
+      int cnt = thread_cnts[i];
+      int64_t yields;
+      int j;
+
+      for (j = 0; j < cnt; j++)
+        if (thread_create ("ready", PRI_DEFAULT - 1 - j % 16, ready_thread,
+                           NULL) == TID_ERROR)
+          fail ("couldn't create thread %d of %d", j, cnt);
+
+      yields = yields_per_tick ();
+      msg ("%d ready threads: %"PRId64" yields/tick, "
+           "%"PRId64"%% of baseline", cnt, yields, yields * 100 / baseline);
+
+      /* Let them all run and exit. */
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_DEFAULT);
+    }
+  pass ();
+}
+
+/* Ready thread, which exits as soon as it gets to run. */
+static void
+ready_thread (void *aux UNUSED) 
+{
+}
+
+/* Returns the average number of times the running thread yields
+   per timer tick over MEASURE_TICKS ticks. */
+static int64_t
+yields_per_tick (void) 
+{
+  int64_t start, yields;
+
+  /* Start at a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    barrier ();
+
+  start = timer_ticks ();
+  yields = 0;
+  while (timer_elapsed (start) < MEASURE_TICKS) 
+    {
+      thread_yield ();
+      yields++;
+    }
+  return yields / MEASURE_TICKS;
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $cnt (0, 10, 100, 1000) {
+    fail "No yield rate reported for $cnt ready threads.\n"
+      if !grep (/^\(priority-scale\) $cnt ready threads: \d+ yields\/tick/,
+		@output);
+}
+fail "Test did not pass.\n" if !grep (/^\(priority-scale\) PASS$/, @output);
+pass;
@@ -0,0 +1,151 @@
+/* Measures how well the scheduler spreads unbalanced work over
+   the CPUs.
+
+   Creates four worker threads per CPU.  One worker in four has
+   eight times as much work to do as the others, so wherever the
+   workers start out, some CPUs run out of work long before the
+   rest.  Each worker busy-waits for its work, so it only makes
+   progress while it runs.  Reports how long all the work took
+   and how many ticks each CPU spent idle meanwhile, which stay
+   small if idle CPUs take ready workers from busy ones.
+
+   While there are more unfinished workers than CPUs, no CPU
+   should go idle and no CPU's ready queue should get much longer
+   than any other's.  The main thread samples the CPUs every tick
+   over that period and reports the widest spread of ready counts
+   it saw and how many ticks each CPU spent idle.
+
+   Run with "pintos --smp=N" to use N CPUs. */
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Work done by a short worker, in milliseconds of busy-waiting. */
+#define SHORT_WORK_MS 200
+
+/* Ratio of long to short work. */
+#define LONG_WORK_RATIO 8
+
+static thread_func worker_thread;
+
+static struct semaphore done;
+
+/* Number of workers that have not finished yet.  Protected by
+   disabling interrupts. */
+static int remaining;
+
+void
+test_smp_balance (void) 
+{
+  int64_t idle[CPU_MAX], busy_idle[CPU_MAX], migrations[CPU_MAX];
+  int64_t start, elapsed, work_ms = 0, migration_cnt = 0;
+  enum intr_level old_level;
+  int worker_cnt = 4 * cpu_cnt;
+  int max_spread = 0;
+  bool overloaded = true;
+  unsigned i;
+  int j;
+
+  msg ("%u CPUs, %d workers.", cpu_cnt, worker_cnt);
+  sema_init (&done, 0);
+  remaining = worker_cnt;
+
+  old_level = intr_disable ();
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      idle[i] = busy_idle[i] = cpus[i].idle_ticks;
+      migrations[i] = cpus[i].migrations;
+    }
+  intr_set_level (old_level);
+
+  start = timer_ticks ();
+  for (j = 0; j < worker_cnt; j++) 
+    {
+      int ms = SHORT_WORK_MS * (j % 4 == 0 ? LONG_WORK_RATIO : 1);
+      char name[24];
+
+      snprintf (name, sizeof name, "worker %d", j);
+      if (thread_create (name, PRI_DEFAULT, worker_thread,
+                         (void *) ms) == TID_ERROR)
+        fail ("couldn't create thread %d", j);
+      work_ms += ms;
+    }
+
+  /* Sample the CPUs once a tick for as long as there are more
+     workers left than CPUs to run them. */
+  while (overloaded) 
+    {
+      int min_ready = INT_MAX, max_ready = 0;
+
+      timer_sleep (1);
+      old_level = intr_disable ();
+      overloaded = remaining > (int) cpu_cnt;
+      if (overloaded)
+        for (i = 0; i < cpu_cnt; i++) 
+          {
+            if (cpus[i].ready_cnt < min_ready)
+              min_ready = cpus[i].ready_cnt;
+            if (cpus[i].ready_cnt > max_ready)
+              max_ready = cpus[i].ready_cnt;
+          }
+      else
+        for (i = 0; i < cpu_cnt; i++)
+          busy_idle[i] = cpus[i].idle_ticks - busy_idle[i];
+      intr_set_level (old_level);
+
+      if (overloaded && max_ready - min_ready > max_spread)
+        max_spread = max_ready - min_ready;
+    }
+
+  for (j = 0; j < worker_cnt; j++)
+    sema_down (&done);
+  elapsed = timer_elapsed (start);
+
+  msg ("%"PRId64" ms of work took %"PRId64" ticks (%"PRId64" ms).",
+       work_ms, elapsed, elapsed * 1000 / TIMER_FREQ);
+
+  old_level = intr_disable ();
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      idle[i] = cpus[i].idle_ticks - idle[i];
+      migrations[i] = cpus[i].migrations - migrations[i];
+    }
+  intr_set_level (old_level);
+
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      msg ("CPU %u: %"PRId64" idle ticks, %"PRId64" threads migrated in.",
+           i, idle[i], migrations[i]);
+      msg ("CPU %u: %"PRId64" idle ticks while overloaded.",
+           i, busy_idle[i]);
+      migration_cnt += migrations[i];
+    }
+  msg ("Ready counts spread by at most %d while overloaded.", max_spread);
+  msg ("%"PRId64" migrations in all.", migration_cnt);
+  pass ();
+}
+
+/* Worker thread.  Busy-waits for AUX milliseconds. */
+static void
+worker_thread (void *ms_) 
+{
+  int ms = (int) ms_;
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < ms / 10; i++)
+    timer_mdelay (10);
+
+  old_level = intr_disable ();
+  remaining--;
+  intr_set_level (old_level);
+  sema_up (&done);
+}
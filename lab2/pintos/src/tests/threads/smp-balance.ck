@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "No CPU count reported.\n"
+  if !grep (/^\(smp-balance\) \d+ CPUs, \d+ workers\.$/, @output);
+fail "No elapsed time reported.\n"
+  if !grep (/^\(smp-balance\) \d+ ms of work took \d+ ticks/, @output);
+fail "No idle ticks reported for CPU 0.\n"
+  if !grep (/^\(smp-balance\) CPU 0: \d+ idle ticks/, @output);
+
+# While there are more workers than CPUs, every CPU should have
+# something to run, and no CPU's ready queue should be more than a
+# few threads longer than another's between periodic rebalances.
+foreach (@output) {
+    fail "CPU $1 idled for $2 ticks with workers waiting elsewhere.\n"
+      if /^\(smp-balance\) CPU (\d+): (\d+) idle ticks while overloaded\.$/
+        && $2 > 2;
+    fail "Ready counts spread by $1 while overloaded, expected at most 3.\n"
+      if /^\(smp-balance\) Ready counts spread by at most (\d+)/ && $1 > 3;
+}
+fail "No ready-count spread reported.\n"
+  if !grep (/^\(smp-balance\) Ready counts spread by at most \d+/, @output);
+
+# The long workers start out bunched together, so some CPUs must
+# take work from others.
+my ($cpu_cnt) = map (/^\(smp-balance\) (\d+) CPUs/, @output);
+my ($migrations) = map (/^\(smp-balance\) (\d+) migrations in all\.$/,
+                        @output);
+fail "No migration count reported.\n" if !defined $migrations;
+fail "No threads migrated between CPUs.\n"
+  if defined $cpu_cnt && $cpu_cnt > 1 && $migrations == 0;
+
+fail "Test did not pass.\n" if !grep (/^\(smp-balance\) PASS$/, @output);
+pass;
@@ -0,0 +1,107 @@
+/* Checks that, under the stride scheduler, CPU-bound threads
+   share the CPU in proportion to their tickets.
+
+   Runs threads with 500, 300, and 200 tickets for SPIN_SECONDS,
+   while the main thread sleeps, and counts how many times each
+   goes around a loop.  The threads should get 50%, 30%, and 20%
+   of the CPU.  The run must cover at least MIN_TICKS timer
+   ticks, so that each share is made up of many scheduling
+   decisions; Make.tests runs this test at 1,000 Hz.  This test
+   assumes a single CPU. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Seconds for which the threads spin. */
+#define SPIN_SECONDS 10
+
+/* Fewest timer ticks for which the threads may spin. */
+#define MIN_TICKS 10000
+
+/* Largest error allowed in each share, in tenths of a percent. */
+#define MAX_ERROR 20
+
+/* Number of spinning threads. */
+#define SPINNERS 3
+
+struct spinner 
+  {
+    int tickets;                /* Number of tickets. */
+    int expected;               /* Expected share, in tenths of %. */
+    int64_t loops;              /* Times around the loop. */
+  };
+
+static thread_func spin_thread;
+
+static volatile bool stop;
+static struct semaphore done;
+
+void
+test_stride_share (void) 
+{
+  static struct spinner spinners[SPINNERS] = 
+    {
+      {500, 500, 0},
+      {300, 300, 0},
+      {200, 200, 0},
+    };
+  int64_t total = 0;
+  int i;
+
+  ASSERT (thread_stride);
+  ASSERT (cpu_cnt == 1);
+  if (SPIN_SECONDS * TIMER_FREQ < MIN_TICKS)
+    fail ("%d seconds at %d Hz is fewer than %d ticks; run with -hz=%d",
+          SPIN_SECONDS, TIMER_FREQ, MIN_TICKS, MIN_TICKS / SPIN_SECONDS);
+
+  sema_init (&done, 0);
+  msg ("Spinning for %d seconds with 500, 300, and 200 tickets...",
+       SPIN_SECONDS);
+  for (i = 0; i < SPINNERS; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "tickets %d", spinners[i].tickets);
+      thread_create (name, PRI_DEFAULT, spin_thread, &spinners[i]);
+    }
+  timer_sleep (SPIN_SECONDS * TIMER_FREQ);
+  stop = true;
+  for (i = 0; i < SPINNERS; i++)
+    sema_down (&done);
+
+  for (i = 0; i < SPINNERS; i++)
+    total += spinners[i].loops;
+  for (i = 0; i < SPINNERS; i++) 
+    {
+      struct spinner *s = &spinners[i];
+      int share = s->loops * 1000 / total;
+      int error = share - s->expected;
+
+      msg ("%d tickets: %d.%d%% of the CPU, expected %d.%d%%.",
+           s->tickets, share / 10, share % 10,
+           s->expected / 10, s->expected % 10);
+      if (error > MAX_ERROR || error < -MAX_ERROR)
+        fail ("%d tickets got %d.%d%% of the CPU, expected %d.%d%%",
+              s->tickets, share / 10, share % 10,
+              s->expected / 10, s->expected % 10);
+    }
+  pass ();
+}
+
+/* Spinning thread.  Sets its tickets and counts loops until told
+   to stop. */
+static void
+spin_thread (void *s_) 
+{
+  struct spinner *s = s_;
+
+  thread_set_tickets (s->tickets);
+  while (!stop)
+    s->loops++;
+  sema_up (&done);
+}
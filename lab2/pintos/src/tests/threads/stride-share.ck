@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $tickets (500, 300, 200) {
+    fail "No CPU share reported for $tickets tickets.\n"
+      if !grep (/^\(stride-share\) $tickets tickets: \d+\.\d% of the CPU/,
+		@output);
+}
+fail "Test did not pass.\n" if !grep (/^\(stride-share\) PASS$/, @output);
+pass;
@@ -0,0 +1,151 @@
+/* The main thread acquires lock A.  A "medium" thread with 400
+   tickets acquires lock B and then blocks acquiring lock A, and a
+   "high" thread with 200 tickets blocks acquiring lock B.  Under
+   the stride scheduler, the medium thread then has its 400
+   tickets plus the high thread's 200, and the main thread has its
+   own 100 plus the medium thread's 600.  Each gives the tickets
+   back as it releases its lock.
+
+   Then the main thread acquires lock C, and two "waiter" threads
+   with 300 and 50 tickets block acquiring it, giving the main
+   thread 450 tickets.  When the main thread releases C, whichever
+   waiter gets it first has its own tickets plus those of the
+   other, still waiting, for 350 in all.  The second holder has no
+   one left to take tickets from.
+
+   The other threads record their tickets, and the main thread
+   reports them after they finish, so that the output does not
+   depend on the order in which the threads run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct locks 
+  {
+    struct lock a;
+    struct lock b;
+    struct semaphore done;
+    int medium_holding;         /* Medium's tickets holding both. */
+    int medium_released;        /* Medium's tickets after release. */
+    int high_holding;           /* High's tickets holding B. */
+    struct lock c;
+    int c_holders;              /* Number of waiters that held C. */
+    int c_holding;              /* First holder's tickets holding C. */
+    int c_extra;                /* Second holder's extra tickets. */
+  };
+
+/* A thread waiting for lock C. */
+struct waiter 
+  {
+    struct locks *locks;
+    int tickets;                /* Tickets to run with. */
+  };
+
+static thread_func medium_thread_func;
+static thread_func high_thread_func;
+static thread_func waiter_thread_func;
+
+void
+test_stride_transfer (void) 
+{
+  struct locks locks;
+  struct waiter waiters[2] = {{&locks, 300}, {&locks, 50}};
+
+  ASSERT (thread_stride);
+  ASSERT (thread_get_tickets () == TICKETS_DEFAULT);
+
+  lock_init (&locks.a);
+  lock_init (&locks.b);
+  lock_init (&locks.c);
+  sema_init (&locks.done, 0);
+  locks.c_holders = 0;
+
+  lock_acquire (&locks.a);
+  thread_create ("medium", PRI_DEFAULT, medium_thread_func, &locks);
+  timer_sleep (10);
+  msg ("Main thread should have 500 tickets.  Actual tickets: %d.",
+       thread_get_tickets ());
+
+  thread_create ("high", PRI_DEFAULT, high_thread_func, &locks);
+  timer_sleep (10);
+  msg ("Main thread should have 700 tickets.  Actual tickets: %d.",
+       thread_get_tickets ());
+
+  lock_release (&locks.a);
+  msg ("Main thread should have 100 tickets.  Actual tickets: %d.",
+       thread_get_tickets ());
+
+  sema_down (&locks.done);
+  sema_down (&locks.done);
+  msg ("Medium thread should have had 600 tickets.  Actual tickets: %d.",
+       locks.medium_holding);
+  msg ("Medium thread should have had 400 tickets.  Actual tickets: %d.",
+       locks.medium_released);
+  msg ("High thread should have had 200 tickets.  Actual tickets: %d.",
+       locks.high_holding);
+
+  lock_acquire (&locks.c);
+  thread_create ("waiter 1", PRI_DEFAULT, waiter_thread_func, &waiters[0]);
+  thread_create ("waiter 2", PRI_DEFAULT, waiter_thread_func, &waiters[1]);
+  timer_sleep (10);
+  msg ("Main thread should have 450 tickets.  Actual tickets: %d.",
+       thread_get_tickets ());
+
+  lock_release (&locks.c);
+  msg ("Main thread should have 100 tickets.  Actual tickets: %d.",
+       thread_get_tickets ());
+
+  sema_down (&locks.done);
+  sema_down (&locks.done);
+  msg ("First holder of C should have had 350 tickets.  "
+       "Actual tickets: %d.", locks.c_holding);
+  msg ("Second holder of C should have had 0 extra tickets.  "
+       "Actual extra tickets: %d.", locks.c_extra);
+}
+
+static void
+medium_thread_func (void *locks_) 
+{
+  struct locks *locks = locks_;
+
+  thread_set_tickets (400);
+  lock_acquire (&locks->b);
+  lock_acquire (&locks->a);
+  locks->medium_holding = thread_get_tickets ();
+  lock_release (&locks->a);
+  lock_release (&locks->b);
+  locks->medium_released = thread_get_tickets ();
+  sema_up (&locks->done);
+}
+
+static void
+high_thread_func (void *locks_) 
+{
+  struct locks *locks = locks_;
+
+  thread_set_tickets (200);
+  lock_acquire (&locks->b);
+  locks->high_holding = thread_get_tickets ();
+  lock_release (&locks->b);
+  sema_up (&locks->done);
+}
+
+static void
+waiter_thread_func (void *waiter_) 
+{
+  struct waiter *waiter = waiter_;
+  struct locks *locks = waiter->locks;
+
+  thread_set_tickets (waiter->tickets);
+  lock_acquire (&locks->c);
+  if (locks->c_holders++ == 0)
+    locks->c_holding = thread_get_tickets ();
+  else
+    locks->c_extra = thread_get_tickets () - waiter->tickets;
+  lock_release (&locks->c);
+  sema_up (&locks->done);
+}
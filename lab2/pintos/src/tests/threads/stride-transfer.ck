@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stride-transfer) begin
+(stride-transfer) Main thread should have 500 tickets.  Actual tickets: 500.
+(stride-transfer) Main thread should have 700 tickets.  Actual tickets: 700.
+(stride-transfer) Main thread should have 100 tickets.  Actual tickets: 100.
+(stride-transfer) Medium thread should have had 600 tickets.  Actual tickets: 600.
+(stride-transfer) Medium thread should have had 400 tickets.  Actual tickets: 400.
+(stride-transfer) High thread should have had 200 tickets.  Actual tickets: 200.
+(stride-transfer) Main thread should have 450 tickets.  Actual tickets: 450.
+(stride-transfer) Main thread should have 100 tickets.  Actual tickets: 100.
+(stride-transfer) First holder of C should have had 350 tickets.  Actual tickets: 350.
+(stride-transfer) Second holder of C should have had 0 extra tickets.  Actual extra tickets: 0.
+(stride-transfer) end
+EOF
+pass;
@@ -16,7 +16,33 @@ static const struct test tests[] =
     {"alarm-simultaneous", test_alarm_simultaneous},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-scale", test_alarm_scale},
+    {"alarm-tickless", test_alarm_tickless},
+    {"alarm-4khz", test_alarm_4khz},
+    {"alarm-periodic", test_alarm_periodic},
+    {"alarm-hires", test_alarm_hires},
+    {"timer-wheel", test_timer_wheel},
+    {"timer-clock", test_timer_clock},
+    {"timer-ticks", test_timer_ticks},
+    {"priority-preempt", test_priority_preempt},
+    {"priority-donate-nest", test_priority_donate_nest},
+    {"priority-donate-multiple", test_priority_donate_multiple},
+    {"priority-condvar", test_priority_condvar},
+    {"priority-scale", test_priority_scale},
+    {"mlfqs-blocked", test_mlfqs_blocked},
+    {"mlfqs-interactive", test_mlfqs_interactive},
+    {"smp-balance", test_smp_balance},
+    {"cfs-share", test_cfs_share},
+    {"stride-share", test_stride_share},
+    {"stride-transfer", test_stride_transfer},
+    {"edf-budget", test_edf_budget},
+    {"thread-create", test_thread_create},
+    {"handoff-pingpong", test_handoff_pingpong},
+    {"top", test_top},
+    {"fpu-switch", test_fpu_switch},
+    {"workqueue", test_workqueue},
     {"batch-scheduler", test_batch_scheduler},
+    {"batch-scheduler-slack", test_batch_scheduler_slack},
   };
 
 static const char *test_name;
@@ -10,9 +10,35 @@ extern test_func test_alarm_multiple;
 extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_scale;
+extern test_func test_alarm_tickless;
+extern test_func test_alarm_4khz;
+extern test_func test_alarm_periodic;
+extern test_func test_alarm_hires;
+extern test_func test_timer_wheel;
+extern test_func test_timer_clock;
+extern test_func test_timer_ticks;
 /*extern test_func test_producer_consumer;
 extern test_func test_narrow_bridge;*/
+extern test_func test_priority_preempt;
+extern test_func test_priority_donate_nest;
+extern test_func test_priority_donate_multiple;
+extern test_func test_priority_condvar;
+extern test_func test_priority_scale;
+extern test_func test_mlfqs_blocked;
+extern test_func test_mlfqs_interactive;
+extern test_func test_smp_balance;
+extern test_func test_cfs_share;
+extern test_func test_stride_share;
+extern test_func test_stride_transfer;
+extern test_func test_edf_budget;
+extern test_func test_thread_create;
+extern test_func test_handoff_pingpong;
+extern test_func test_top;
+extern test_func test_fpu_switch;
+extern test_func test_workqueue;
 extern test_func test_batch_scheduler;
+extern test_func test_batch_scheduler_slack;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,56 @@
+/* Measures how fast threads can be created and run to exit.
+
+   Creates BURSTS bursts of BURST_SIZE threads that exit at once,
+   waiting for each burst to finish before starting the next, the
+   way a batch of short-lived workers comes and goes, and reports
+   the rate.  Past the first burst, the threads should run in the
+   pages of the threads that exited before them. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of bursts. */
+#define BURSTS 100
+
+/* Number of threads in each burst. */
+#define BURST_SIZE 20
+
+static thread_func exit_thread;
+
+void
+test_thread_create (void) 
+{
+  struct semaphore done;
+  int64_t start, elapsed;
+  int i, j;
+
+  sema_init (&done, 0);
+  start = timer_now_ns ();
+  for (i = 0; i < BURSTS; i++) 
+    {
+      for (j = 0; j < BURST_SIZE; j++)
+        if (thread_create ("worker", PRI_DEFAULT, exit_thread, &done)
+            == TID_ERROR)
+          fail ("thread_create failed in burst %d", i);
+      for (j = 0; j < BURST_SIZE; j++)
+        sema_down (&done);
+    }
+  elapsed = timer_now_ns () - start;
+
+  msg ("%d threads created and exited.", BURSTS * BURST_SIZE);
+  msg ("%"PRId64" ns per thread, %"PRId64" threads per second.",
+       elapsed / (BURSTS * BURST_SIZE),
+       elapsed > 0 ? BURSTS * BURST_SIZE * 1000000000LL / elapsed : 0);
+  pass ();
+}
+
+/* Signals that it ran, and exits. */
+static void
+exit_thread (void *done) 
+{
+  sema_up (done);
+}
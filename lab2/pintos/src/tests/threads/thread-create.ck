@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Rate not reported.\n"
+  if !grep (/^\(thread-create\) \d+ ns per thread, \d+ threads per second\.$/,
+	    @output);
+fail "Test did not pass.\n" if !grep (/^\(thread-create\) PASS$/, @output);
+pass;
@@ -0,0 +1,87 @@
+/* Checks the nanosecond clock.  timer_now_ns() must never go
+   backward, must be readable from an interrupt handler, and must
+   keep pace with the timer tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "devices/timer-wheel.h"
+
+/* Number of successive clock readings checked for order. */
+#define READ_CNT 100000
+
+/* Ticks over which the clock's rate is compared to the tick. */
+#define RATE_TICKS 50
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+
+/* Clock readings taken by a kernel timer. */
+struct clock_sample 
+  {
+    int64_t ns;                 /* timer_now_ns() at that time. */
+    bool done;                  /* Set once the timer has run. */
+  };
+
+static void take_sample (void *);
+
+void
+test_timer_clock (void) 
+{
+  struct clock_sample sample;
+  struct timer timer;
+  int64_t prev, now, start_ticks, start_ns, ticks, ns;
+  int i;
+
+  /* Successive readings never decrease, even across ticks. */
+  prev = timer_now_ns ();
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      now = timer_now_ns ();
+      if (now < prev)
+        fail ("clock went back from %lld to %lld ns", prev, now);
+      prev = now;
+    }
+  msg ("%d readings in order", READ_CNT);
+
+  /* The clock runs at the same rate as the tick, to within a
+     tick plus 1%.  Start at a tick boundary. */
+  start_ticks = timer_ticks ();
+  while (timer_ticks () == start_ticks)
+    continue;
+  start_ticks = timer_ticks ();
+  start_ns = timer_now_ns ();
+  timer_sleep (RATE_TICKS);
+  ticks = timer_elapsed (start_ticks);
+  ns = timer_now_ns () - start_ns;
+  if (ns < (ticks - 1) * NS_PER_TICK - ticks * NS_PER_TICK / 100
+      || ns > (ticks + 1) * NS_PER_TICK + ticks * NS_PER_TICK / 100)
+    fail ("%lld ns passed during %lld ticks", ns, ticks);
+  msg ("clock keeps pace with timer ticks");
+
+  /* It can be read in an interrupt handler, where it agrees with
+     readings from thread context. */
+  sample.done = false;
+  timer_setup (&timer, take_sample, &sample);
+  start_ns = timer_now_ns ();
+  timer_add (&timer, 5);
+  while (!sample.done)
+    thread_yield ();
+  if (sample.ns < start_ns || sample.ns > timer_now_ns ())
+    fail ("reading from interrupt handler out of order");
+  msg ("clock readable from interrupt handler");
+  pass ();
+}
+
+/* Kernel timer function that records the time in SAMPLE_. */
+static void
+take_sample (void *sample_) 
+{
+  struct clock_sample *sample = sample_;
+
+  ASSERT (intr_context ());
+  sample->ns = timer_now_ns ();
+  sample->done = true;
+}
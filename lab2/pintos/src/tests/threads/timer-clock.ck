@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-clock) begin
+(timer-clock) 100000 readings in order
+(timer-clock) clock keeps pace with timer ticks
+(timer-clock) clock readable from interrupt handler
+(timer-clock) PASS
+(timer-clock) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Checks that timer_ticks(), which does not disable interrupts,
+   never returns a torn value.  Reads the tick count as fast as
+   possible for a number of ticks, so that many reads are
+   interrupted by the timer, and verifies that it only ever moves
+   forward by one.  Also checks that a kernel timer sees the tick
+   it was due on. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "devices/timer-wheel.h"
+
+/* Number of ticks over which the count is read. */
+#define READ_TICKS 100
+
+static void record_tick (void *);
+
+void
+test_timer_ticks (void) 
+{
+  struct timer timer;
+  int64_t start, prev, now, due;
+  volatile int64_t seen = -1;
+
+  /* This test relies on a periodic tick. */
+  ASSERT (!timer_tickless);
+
+  start = prev = timer_ticks ();
+  while (prev - start < READ_TICKS) 
+    {
+      now = timer_ticks ();
+      if (now != prev && now != prev + 1)
+        fail ("tick count went from %lld to %lld", prev, now);
+      prev = now;
+    }
+  msg ("tick count read consistently for %d ticks", READ_TICKS);
+
+  timer_setup (&timer, record_tick, (void *) &seen);
+  timer_add (&timer, 3);
+  due = timer.expires;
+  while (seen < 0)
+    thread_yield ();
+  if (seen != due)
+    fail ("timer due on tick %lld saw tick %lld", due, seen);
+  msg ("kernel timer saw the tick it was due on");
+  pass ();
+}
+
+/* Kernel timer function that stores the tick count in *SEEN_. */
+static void
+record_tick (void *seen_) 
+{
+  volatile int64_t *seen = seen_;
+
+  ASSERT (intr_context ());
+  *seen = timer_ticks ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-ticks) begin
+(timer-ticks) tick count read consistently for 100 ticks
+(timer-ticks) kernel timer saw the tick it was due on
+(timer-ticks) PASS
+(timer-ticks) end
+EOF
+pass;
@@ -0,0 +1,123 @@
+/* Checks kernel timers.  Timers added at a range of delays,
+   including ones far enough out to be cascaded down from the
+   upper levels of the timing wheel, must each run exactly once,
+   on the tick they were due.  A cancelled timer must not run, a
+   modified timer must run only at its new expiry, and a timer
+   that rearms itself from its own callback must keep running. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "devices/timer-wheel.h"
+
+/* A timer and what happened to it. */
+struct timer_check 
+  {
+    struct timer timer;         /* The timer. */
+    int64_t due;                /* Tick it should run on. */
+    int64_t ran_at;             /* Tick it last ran on. */
+    int runs;                   /* Number of times it ran. */
+  };
+
+/* Number of times the rearming timer runs. */
+#define REARM_CNT 3
+
+/* Ticks between runs of the rearming timer. */
+#define REARM_PERIOD 7
+
+static void record (void *);
+static void record_and_rearm (void *);
+
+void
+test_timer_wheel (void) 
+{
+  static const int delays[] = {1, 5, 255, 256, 257, 300, 1000, 1100};
+  enum { DELAY_CNT = sizeof delays / sizeof *delays };
+  struct timer_check checks[DELAY_CNT];
+  struct timer_check cancelled, modified, rearmed;
+  enum intr_level old_level;
+  int64_t start;
+  int i;
+
+  /* Add all the timers on the same tick. */
+  old_level = intr_disable ();
+  start = timer_ticks ();
+  for (i = 0; i < DELAY_CNT; i++) 
+    {
+      struct timer_check *c = &checks[i];
+      timer_setup (&c->timer, record, c);
+      c->due = start + delays[i];
+      c->runs = 0;
+      timer_add (&c->timer, delays[i]);
+    }
+
+  timer_setup (&cancelled.timer, record, &cancelled);
+  cancelled.runs = 0;
+  timer_add (&cancelled.timer, 50);
+
+  timer_setup (&modified.timer, record, &modified);
+  modified.due = start + 600;
+  modified.runs = 0;
+  timer_add (&modified.timer, 40);
+
+  timer_setup (&rearmed.timer, record_and_rearm, &rearmed);
+  rearmed.due = start + REARM_CNT * REARM_PERIOD;
+  rearmed.runs = 0;
+  timer_add (&rearmed.timer, REARM_PERIOD);
+  intr_set_level (old_level);
+
+  if (!timer_cancel (&cancelled.timer))
+    fail ("cancelled timer was not pending");
+  if (timer_cancel (&cancelled.timer))
+    fail ("cancelled timer was still pending after timer_cancel()");
+  if (!timer_mod (&modified.timer, modified.due - timer_ticks ()))
+    fail ("modified timer was not pending");
+
+  timer_sleep (delays[DELAY_CNT - 1] + 10);
+
+  for (i = 0; i < DELAY_CNT; i++) 
+    {
+      struct timer_check *c = &checks[i];
+      if (c->runs != 1)
+        fail ("timer due after %d ticks ran %d times", delays[i], c->runs);
+      msg ("timer due after %d ticks ran %d ticks late",
+           delays[i], (int) (c->ran_at - c->due));
+    }
+  if (cancelled.runs != 0)
+    fail ("cancelled timer ran");
+  msg ("cancelled timer did not run");
+  if (modified.runs != 1 || modified.ran_at != modified.due)
+    fail ("modified timer ran %d times, last %d ticks after its new expiry",
+          modified.runs, (int) (modified.ran_at - modified.due));
+  msg ("modified timer ran once, at its new expiry");
+  if (rearmed.runs != REARM_CNT || rearmed.ran_at != rearmed.due)
+    fail ("rearming timer ran %d times instead of %d",
+          rearmed.runs, REARM_CNT);
+  msg ("rearming timer ran %d times, every %d ticks",
+       REARM_CNT, REARM_PERIOD);
+  pass ();
+}
+
+/* Timer callback that records when it ran. */
+static void
+record (void *c_) 
+{
+  struct timer_check *c = c_;
+
+  c->ran_at = timer_ticks ();
+  c->runs++;
+}
+
+/* Timer callback that records when it ran and rearms its timer
+   until it has run REARM_CNT times. */
+static void
+record_and_rearm (void *c_) 
+{
+  struct timer_check *c = c_;
+
+  record (c);
+  if (c->runs < REARM_CNT)
+    timer_add (&c->timer, REARM_PERIOD);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-wheel) begin
+(timer-wheel) timer due after 1 ticks ran 0 ticks late
+(timer-wheel) timer due after 5 ticks ran 0 ticks late
+(timer-wheel) timer due after 255 ticks ran 0 ticks late
+(timer-wheel) timer due after 256 ticks ran 0 ticks late
+(timer-wheel) timer due after 257 ticks ran 0 ticks late
+(timer-wheel) timer due after 300 ticks ran 0 ticks late
+(timer-wheel) timer due after 1000 ticks ran 0 ticks late
+(timer-wheel) timer due after 1100 ticks ran 0 ticks late
+(timer-wheel) cancelled timer did not run
+(timer-wheel) modified timer ran once, at its new expiry
+(timer-wheel) rearming timer ran 3 times, every 7 ticks
+(timer-wheel) PASS
+(timer-wheel) end
+EOF
+pass;
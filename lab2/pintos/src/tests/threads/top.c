@@ -0,0 +1,46 @@
+/* Checks that top_print() shows a thread that keeps the CPU busy
+   as the busiest, with most of a CPU's time.
+
+   Runs a busy thread, "hog", while the main thread sleeps for a
+   second, then prints the busiest threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/top.h"
+#include "devices/timer.h"
+
+static thread_func hog_thread;
+
+static volatile bool stop;
+static struct semaphore done;
+
+void
+test_top (void) 
+{
+  sema_init (&done, 0);
+  stop = false;
+
+  /* Start counting from here. */
+  top_print ();
+
+  thread_create ("hog", PRI_DEFAULT, hog_thread, NULL);
+  timer_sleep (TIMER_FREQ);
+  msg ("Busiest threads:");
+  top_print ();
+
+  stop = true;
+  sema_down (&done);
+  pass ();
+}
+
+/* Spins until told to stop. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    continue;
+  sema_up (&done);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Find the dump after "Busiest threads:".
+my ($i) = grep ($output[$_] eq '(top) Busiest threads:', 0...$#output);
+fail "Missing second dump.\n" if !defined $i;
+fail "Missing dump header.\n"
+  if $i + 3 > $#output
+    || $output[$i + 1] !~ /^top: \d+ s up, \d+ threads, busiest over last \d+ ticks:$/
+    || $output[$i + 2] !~ /^top:\s+TID NAME\s+S PRI\s+%CPU/;
+
+# The hog should be busiest, with at least 80% of the CPU.
+my ($row) = $output[$i + 3];
+my ($name, $state, $cpu) = $row =~ /^top:\s+\d+ (\S+)\s+(\S) +\d+ +(\d+)\.\d /
+  or fail "Malformed row: $row\n";
+fail "Busiest thread is $name, not hog.\n" if $name ne 'hog';
+fail "hog should be ready, not state $state.\n" if $state ne 'r';
+fail "hog had only $cpu% of the CPU.\n" if $cpu < 80;
+fail "Test did not pass.\n" if !grep (/^\(top\) PASS$/, @output);
+pass;
@@ -0,0 +1,118 @@
+/* Checks the work queues.  Queues work items from a kernel
+   timer, which runs in the timer interrupt, and checks that each
+   runs once.  Then checks that a work item queued twice before it
+   runs only runs once, that delayed work waits out its delay,
+   and that cancelled delayed work does not run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+#include "devices/timer-wheel.h"
+
+/* Number of work items queued from the timer. */
+#define WORK_CNT 50
+
+/* Delay of the delayed work, in ticks. */
+#define DELAY 10
+
+static struct work works[WORK_CNT];
+static int run_cnt[WORK_CNT];
+static struct semaphore done;
+static int64_t ran_at;
+
+static timer_func queue_works;
+static work_func count_work;
+static work_func delayed_func;
+
+void
+test_workqueue (void) 
+{
+  struct timer timer;
+  struct delayed_work dw;
+  enum intr_level old_level;
+  int64_t start;
+  bool first, second;
+  int i;
+
+  sema_init (&done, 0);
+  for (i = 0; i < WORK_CNT; i++)
+    work_init (&works[i], count_work, &run_cnt[i]);
+
+  /* Work queued in interrupt context. */
+  timer_setup (&timer, queue_works, NULL);
+  timer_add (&timer, 1);
+  for (i = 0; i < WORK_CNT; i++)
+    sema_down (&done);
+  timer_sleep (DELAY);
+  for (i = 0; i < WORK_CNT; i++)
+    if (run_cnt[i] != 1)
+      fail ("work item %d ran %d times", i, run_cnt[i]);
+  msg ("%d work items queued from a timer each ran once.", WORK_CNT);
+
+  /* Work queued twice. */
+  run_cnt[0] = 0;
+  old_level = intr_disable ();
+  first = work_queue (&works[0]);
+  second = work_queue (&works[0]);
+  intr_set_level (old_level);
+  sema_down (&done);
+  timer_sleep (DELAY);
+  if (!first || second || run_cnt[0] != 1)
+    fail ("work item queued twice ran %d times", run_cnt[0]);
+  msg ("Work item queued twice ran once.");
+
+  /* Delayed work. */
+  delayed_work_init (&dw, delayed_func, NULL);
+  start = timer_ticks ();
+  if (!work_queue_delayed (&dw, DELAY))
+    fail ("could not queue delayed work");
+  sema_down (&done);
+  if (ran_at - start < DELAY)
+    fail ("delayed work ran after %lld ticks", ran_at - start);
+  msg ("Delayed work ran after its delay.");
+
+  /* Cancelled delayed work. */
+  ran_at = -1;
+  work_queue_delayed (&dw, DELAY);
+  if (!delayed_work_cancel (&dw))
+    fail ("could not cancel delayed work");
+  timer_sleep (DELAY * 2);
+  if (ran_at != -1)
+    fail ("cancelled delayed work ran");
+  msg ("Cancelled delayed work did not run.");
+}
+
+/* Timer function that queues every work item. */
+static void
+queue_works (void *aux UNUSED) 
+{
+  int i;
+
+  ASSERT (intr_context ());
+  for (i = 0; i < WORK_CNT; i++)
+    if (!work_queue (&works[i]))
+      fail ("work item %d already pending", i);
+}
+
+/* Work function that counts its runs in *CNT_. */
+static void
+count_work (void *cnt_) 
+{
+  int *cnt = cnt_;
+
+  ASSERT (!intr_context ());
+  (*cnt)++;
+  sema_up (&done);
+}
+
+/* Delayed work function that records when it ran. */
+static void
+delayed_func (void *aux UNUSED) 
+{
+  ran_at = timer_ticks ();
+  sema_up (&done);
+}
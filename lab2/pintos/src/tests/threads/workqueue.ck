@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) 50 work items queued from a timer each ran once.
+(workqueue) Work item queued twice ran once.
+(workqueue) Delayed work ran after its delay.
+(workqueue) Cancelled delayed work did not run.
+(workqueue) end
+EOF
+pass;
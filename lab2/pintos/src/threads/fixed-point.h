@@ -0,0 +1,88 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, for the MLFQS.
+
+   A fixed-point number is an int whose low FIX_SHIFT bits hold
+   the fraction, so it can represent values from about -131,072
+   to 131,072 with a resolution of 1/16,384.  Products and
+   quotients of two fixed-point numbers go through 64 bits so
+   they do not overflow in between. */
+typedef int fixed_point;
+
+#define FIX_SHIFT 14                    /* # of fraction bits. */
+#define FIX_ONE (1 << FIX_SHIFT)        /* 1.0. */
+
+/* Returns integer N as a fixed-point number. */
+static inline fixed_point
+fix_int (int n)
+{
+  return n * FIX_ONE;
+}
+
+/* Returns N / D as a fixed-point number. */
+static inline fixed_point
+fix_frac (int n, int d)
+{
+  return (int64_t) n * FIX_ONE / d;
+}
+
+/* Returns X truncated toward zero to an integer. */
+static inline int
+fix_trunc (fixed_point x)
+{
+  return x / FIX_ONE;
+}
+
+/* Returns X rounded to the nearest integer. */
+static inline int
+fix_round (fixed_point x)
+{
+  return (x >= 0 ? x + FIX_ONE / 2 : x - FIX_ONE / 2) / FIX_ONE;
+}
+
+/* Returns X + Y. */
+static inline fixed_point
+fix_add (fixed_point x, fixed_point y)
+{
+  return x + y;
+}
+
+/* Returns X - Y. */
+static inline fixed_point
+fix_sub (fixed_point x, fixed_point y)
+{
+  return x - y;
+}
+
+/* Returns X * Y. */
+static inline fixed_point
+fix_mul (fixed_point x, fixed_point y)
+{
+  return (int64_t) x * y / FIX_ONE;
+}
+
+/* Returns X / Y. */
+static inline fixed_point
+fix_div (fixed_point x, fixed_point y)
+{
+  return (int64_t) x * FIX_ONE / y;
+}
+
+/* Returns X * N, for integer N. */
+static inline fixed_point
+fix_scale (fixed_point x, int n)
+{
+  return x * n;
+}
+
+/* Returns X / N, for integer N. */
+static inline fixed_point
+fix_unscale (fixed_point x, int n)
+{
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
@@ -0,0 +1,297 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/smp.h"
+#include "threads/thread.h"
+
+/* start.S and ap-start.S set CR0.EM, so that any use of the FPU
+   raises #NM, and fpu_init() and fpu_init_ap() clear it only
+   once they know that the CPU has what it takes to save and
+   restore the SSE registers.  See [IA32-v3a] 13.1 "Providing
+   Operating System Support for SSE Extensions". */
+
+/* Flags in control register 0.  See [IA32-v3a] 2.5 "Control
+   Registers". */
+#define CR0_MP 0x00000002       /* Monitor coProcessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008       /* Task Switched. */
+#define CR0_NE 0x00000020       /* Numeric Error. */
+
+/* Flags in control register 4. */
+#define CR4_OSFXSR 0x00000200   /* FXSAVE, FXRSTOR, and SSE. */
+#define CR4_OSXMMEXCPT 0x00000400 /* SIMD floating-point exceptions. */
+
+/* MXCSR at reset: all SIMD floating-point exceptions masked. */
+#define MXCSR_DEFAULT 0x1f80
+
+/* A thread's saved FPU state.  FXSAVE needs a 16-byte aligned
+   area, which malloc() does not guarantee, so each is carved out
+   of a block 15 bytes larger. */
+struct fpu_state
+  {
+    uint8_t fxsave[512];        /* FXSAVE area. */
+    bool valid;                 /* Saved yet?  If not, the state is
+                                   the one FNINIT sets up. */
+    void *block;                /* Block from malloc(). */
+  }
+__attribute__ ((aligned (16)));
+
+/* Does the CPU have FXSAVE and SSE? */
+static bool present;
+
+static intr_handler_func nm_exception;
+static void enable (void);
+static void load (struct thread *);
+static struct fpu_state **active_state (struct thread *);
+static struct fpu_state *alloc_state (void);
+static void free_state (struct fpu_state *);
+static void stts (void);
+
+/* Checks whether the boot CPU has FXSAVE and SSE, and if so,
+   lets threads use them.  Otherwise, any use of the FPU raises
+   #NM, as before. */
+void
+fpu_init (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  /* See [IA32-v2a] "CPUID".  EDX bit 24 is set if the CPU has
+     FXSAVE and FXRSTOR, and bit 25 if it has SSE. */
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  present = (edx & (1 << 24)) != 0 && (edx & (1 << 25)) != 0;
+  if (!present)
+    return;
+
+  intr_register_int (7, 0, INTR_ON, nm_exception,
+                     "#NM Device Not Available Exception");
+  enable ();
+}
+
+/* Lets threads use the FPU on an application processor, if the
+   boot processor allowed it.  The APs are assumed to be like the
+   boot processor. */
+void
+fpu_init_ap (void) 
+{
+  if (present)
+    enable ();
+}
+
+/* Returns true if threads may use the FPU and SSE. */
+bool
+fpu_available (void) 
+{
+  return present;
+}
+
+/* Lets kernel code use the FPU, starting from a fresh state,
+   until fpu_end().  The running thread's own FPU state is saved
+   first, if the thread has used the FPU. */
+void
+fpu_begin (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (present);
+  ASSERT (!intr_context ());
+  ASSERT (!cur->fpu_in_kernel);
+
+  if (cur->fpu_kernel == NULL) 
+    {
+      cur->fpu_kernel = alloc_state ();
+      if (cur->fpu_kernel == NULL)
+        PANIC ("out of memory for FPU state");
+    }
+
+  old_level = intr_disable ();
+  if (cur->fpu_used)
+    fpu_save (cur);
+  cur->fpu_kernel->valid = false;
+  cur->fpu_in_kernel = true;
+  cur->fpu_cpu = NULL;
+  intr_set_level (old_level);
+}
+
+/* Ends a use of the FPU by kernel code that fpu_begin() began,
+   discarding the kernel's FPU state.  The thread's own state is
+   loaded again when it next uses the FPU. */
+void
+fpu_end (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (cur->fpu_in_kernel);
+
+  old_level = intr_disable ();
+  if (cur->fpu_used) 
+    {
+      cur->fpu_used = false;
+      stts ();
+    }
+  cur->fpu_in_kernel = false;
+  cur->fpu_cpu = NULL;
+  intr_set_level (old_level);
+}
+
+/* Saves the FPU state of T, the running thread, which has used
+   the FPU since it was switched in, so that its next use raises
+   #NM again.  Called by the scheduler when it switches T out.
+   Interrupts must be off. */
+void
+fpu_save (struct thread *t) 
+{
+  struct fpu_state *s = *active_state (t);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->fpu_used);
+
+  asm volatile ("fxsave %0" : "=m" (s->fxsave));
+  s->valid = true;
+  t->fpu_used = false;
+  stts ();
+}
+
+/* Frees the running thread's FPU state.  Called by
+   thread_exit(). */
+void
+fpu_exit (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (cur->fpu_used) 
+    {
+      cur->fpu_used = false;
+      stts ();
+    }
+  if (cur->cpu->fpu_last == cur)
+    cur->cpu->fpu_last = NULL;
+  intr_set_level (old_level);
+
+  free_state (cur->fpu);
+  free_state (cur->fpu_kernel);
+  cur->fpu = cur->fpu_kernel = NULL;
+}
+
+/* #NM handler: the running thread used the FPU for the first
+   time since it was switched in.  Loads its state, allocating it
+   first if the thread has not used the FPU before. */
+static void
+nm_exception (struct intr_frame *f) 
+{
+  struct thread *cur = thread_current ();
+  struct fpu_state **s = active_state (cur);
+  enum intr_level old_level;
+
+  if (intr_context ())
+    PANIC ("FPU used in an interrupt handler");
+  if (f->cs == SEL_KCSEG && !cur->fpu_in_kernel)
+    PANIC ("FPU used in kernel outside fpu_begin() and fpu_end()");
+
+  if (*s == NULL) 
+    {
+      *s = alloc_state ();
+      if (*s == NULL) 
+        {
+          printf ("%s: out of memory for FPU state\n", cur->name);
+          thread_exit ();
+        }
+    }
+
+  old_level = intr_disable ();
+  if (!cur->fpu_used)
+    load (cur);
+  intr_set_level (old_level);
+}
+
+/* Turns on the FPU and SSE on the running CPU, with CR0.TS set,
+   so that the first thread to use them raises #NM. */
+static void
+enable (void) 
+{
+  uint32_t cr0, cr4;
+
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  cr0 = (cr0 & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS;
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0) : "memory");
+
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Loads T's FPU state, which T, the running thread, is about to
+   use, and clears CR0.TS.  If the CPU's registers still hold that
+   state, because T was the last thread to use the FPU here and
+   has not used it elsewhere since, they are left as they are.
+   Interrupts must be off. */
+static void
+load (struct thread *t) 
+{
+  struct cpu *c = t->cpu;
+  struct fpu_state *s = *active_state (t);
+  static const uint32_t mxcsr = MXCSR_DEFAULT;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (s != NULL);
+
+  asm volatile ("clts" : : : "memory");
+  if (!s->valid)
+    asm volatile ("fninit; ldmxcsr %0" : : "m" (mxcsr));
+  else if (c->fpu_last != t || t->fpu_cpu != c)
+    asm volatile ("fxrstor %0" : : "m" (s->fxsave));
+  c->fpu_last = t;
+  t->fpu_cpu = c;
+  t->fpu_used = true;
+}
+
+/* Returns the location of the FPU state that T uses now: the
+   kernel's between fpu_begin() and fpu_end(), otherwise T's
+   own. */
+static struct fpu_state **
+active_state (struct thread *t) 
+{
+  return t->fpu_in_kernel ? &t->fpu_kernel : &t->fpu;
+}
+
+/* Returns a new FPU state, not yet valid, or a null pointer if
+   memory is short. */
+static struct fpu_state *
+alloc_state (void) 
+{
+  void *block = malloc (sizeof (struct fpu_state) + 15);
+  struct fpu_state *s;
+
+  if (block == NULL)
+    return NULL;
+  s = (struct fpu_state *) ROUND_UP ((uintptr_t) block, 16);
+  s->valid = false;
+  s->block = block;
+  return s;
+}
+
+/* Frees S, which may be a null pointer. */
+static void
+free_state (struct fpu_state *s) 
+{
+  if (s != NULL)
+    free (s->block);
+}
+
+/* Sets CR0.TS, so that the next use of the FPU raises #NM. */
+static void
+stts (void) 
+{
+  uint32_t cr0;
+
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0 | CR0_TS) : "memory");
+}
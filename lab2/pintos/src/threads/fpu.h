@@ -0,0 +1,36 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+/* Floating-point and SSE state.
+
+   On a CPU with FXSAVE and SSE, threads may use the x87 FPU and
+   the SSE registers, and each thread has a copy of them of its
+   own.  The copies are switched lazily: a thread switch sets
+   CR0.TS, so that a thread's first use of the FPU after it is
+   switched in raises a #NM exception, whose handler loads the
+   thread's state into the CPU, and only a thread that used the
+   FPU has its state saved when it is switched out.  Threads that
+   never touch the FPU cost nothing at a switch.
+
+   User programs may use the FPU freely.  Kernel code must put
+   its use of the FPU between fpu_begin() and fpu_end(), which
+   give it a fresh state of its own, so that it does not clobber
+   the state of the user program the thread may be running.  Such
+   a region may sleep and be preempted, but it may not nest or be
+   entered in an interrupt handler. */
+
+struct thread;
+
+void fpu_init (void);
+void fpu_init_ap (void);
+bool fpu_available (void);
+
+void fpu_begin (void);
+void fpu_end (void);
+
+void fpu_save (struct thread *);
+void fpu_exit (void);
+
+#endif /* threads/fpu.h */
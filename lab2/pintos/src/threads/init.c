@@ -10,18 +10,23 @@
 #include <string.h>
 #include "devices/kbd.h"
 #include "devices/input.h"
+#include "devices/lapic.h"
 #include "devices/serial.h"
 #include "devices/shutdown.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
+#include "threads/top.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -107,6 +112,8 @@ main (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  fpu_init ();
+  lapic_init ();
   timer_init ();
   kbd_init ();
   input_init ();
@@ -119,6 +126,9 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  smp_init ();
+  workqueue_init ();
+  top_init ();
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -256,6 +266,18 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-handoff"))
+        thread_handoff = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-hz"))
+        timer_freq = atoi (value);
+      else if (!strcmp (name, "-top"))
+        top_interval = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -263,6 +285,8 @@ parse_options (char **argv)
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs + thread_cfs + thread_stride > 1)
+    PANIC ("only one of -mlfqs, -cfs, and -stride may be used");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -379,6 +403,12 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use completely fair scheduler.\n"
+          "  -stride            Use stride scheduler.\n"
+          "  -handoff           Hand time slices to threads woken on block.\n"
+          "  -tickless          Stop the timer tick while idle.\n"
+          "  -hz=FREQ           Interrupt FREQ times per second (default 100).\n"
+          "  -top=SECS          Print busiest threads every SECS seconds.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
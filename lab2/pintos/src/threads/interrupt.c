@@ -6,8 +6,11 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/smp.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -43,13 +46,48 @@ static unsigned int unexpected_cnt[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU keeps track of the external
+   interrupt it is processing in its struct cpu: whether it is
+   processing one (`in_external_intr'), whether it should yield on
+   return (`yield_on_return'), and, while such a yield is in
+   progress, the TSC value at its start and the interrupt's vector
+   (`yield_start', `yield_vec_no'), for intr_yield_complete() to
+   account for its cost. */
+
+/* Interrupts-off lock.
+
+   On a multiprocessor, turning interrupts off keeps a CPU's own
+   interrupt handlers and scheduler out of a critical section,
+   but not the other CPUs.  So that every critical section written
+   for a uniprocessor, by turning interrupts off, remains one, a
+   CPU also holds intr_lock whenever its interrupts are off:
+   intr_disable() acquires it and intr_enable() releases it, and
+   intr_handler() does the same around a handler entered through
+   an interrupt gate.  Thus at most one CPU at a time runs with
+   interrupts off, and the others run concurrently only with
+   interrupts on, as the code of user programs and most of the
+   kernel does.
+
+   The lock belongs to the CPU rather than to a thread: a thread
+   that blocks or yields with interrupts off hands it to the next
+   thread to run on the same CPU, which releases it when it turns
+   interrupts back on.  The boot CPU starts out with interrupts
+   off, so intr_lock starts out held. */
+static struct spinlock intr_lock = SPINLOCK_LOCKED;
+
+/* Longest time any CPU has run with interrupts off, in TSC
+   cycles, and the code that turned them off at its start: the
+   caller of intr_disable(), or the handler of an interrupt that
+   arrived with interrupts on.  Each CPU notes when and where its
+   interrupts went off in its struct cpu (`off_start',
+   `off_where').  Protected by intr_lock. */
+static uint64_t off_max;
+static void *off_max_where;
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
+static bool is_external (uint8_t vec_no);
 
 /* Interrupt Descriptor Table helpers. */
 static uint64_t make_intr_gate (void (*) (void), int dpl);
@@ -59,6 +97,8 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
+static void off_begin (void *where);
+static void off_end (void);
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -90,6 +130,12 @@ intr_enable (void)
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (old_level == INTR_OFF) 
+    {
+      off_end ();
+      spin_unlock (&intr_lock);
+    }
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -110,8 +156,37 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON) 
+    {
+      spin_lock (&intr_lock);
+      off_begin (__builtin_return_address (0));
+    }
+
   return old_level;
 }
+
+/* Enables interrupts and halts the CPU until the next interrupt
+   arrives.  Interrupts must be off.
+
+   The `sti' instruction disables interrupts until the
+   completion of the next instruction, so `sti; hlt' is
+   atomic.  This atomicity is important; otherwise, an interrupt
+   could be handled between re-enabling interrupts and waiting
+   for the next one to occur, wasting as much as one clock tick
+   worth of time.
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a] 7.11.1
+   "HLT Instruction". */
+void
+intr_wait (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!intr_context ());
+
+  off_end ();
+  spin_unlock (&intr_lock);
+  asm volatile ("sti; hlt" : : : "memory");
+}
 
 /* Initializes the interrupt system. */
 void
@@ -157,6 +232,23 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Initializes the interrupt system on an application processor,
+   which shares the boot processor's IDT.  The processor starts
+   with interrupts off, so this also acquires intr_lock for it,
+   waiting for any other CPU that has interrupts off. */
+void
+intr_init_ap (void) 
+{
+  uint64_t idtr_operand;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+
+  spin_lock (&intr_lock);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -176,12 +268,14 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  VEC_NO is either a PIC
+   vector (0x20...0x2f) or a local APIC vector
+   (LAPIC_VEC_FIRST...LAPIC_VEC_LAST). */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT (is_external (vec_no));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,16 +296,25 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
+/* Returns true if VEC_NO is an external interrupt vector, one
+   raised by the PICs or by the local APIC, false otherwise. */
+static bool
+is_external (uint8_t vec_no) 
+{
+  return ((vec_no >= 0x20 && vec_no <= 0x2f)
+          || (vec_no >= LAPIC_VEC_FIRST && vec_no <= LAPIC_VEC_LAST));
+}
+
 /* Returns true during processing of an external interrupt
    and false at all other times. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  return cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +325,25 @@ void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  cpu_current ()->yield_on_return = true;
+}
+
+/* Called by the scheduler, with interrupts off, once a thread
+   switch is complete.  If the switch was the yield at the end of
+   an external interrupt, reports the cycles it took to the timer,
+   which accounts for the cost of its own interrupts. */
+void
+intr_yield_complete (void) 
+{
+  struct cpu *c = cpu_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (c->yield_start != 0) 
+    {
+      timer_account_yield (c->yield_vec_no, timer_cycles () - c->yield_start);
+      c->yield_start = 0;
+    }
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -346,23 +467,35 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  struct cpu *c;
+
+  /* Entering through an interrupt gate turned interrupts off.  If
+     they were on before, acquire intr_lock, as intr_disable()
+     would have.  (If they were off, this CPU holds it already.) */
+  handler = intr_handlers[frame->vec_no];
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF) 
+    {
+      spin_lock (&intr_lock);
+      off_begin (handler != NULL ? (void *) handler : (void *) frame->eip);
+    }
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
-     An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+     and they need to be acknowledged on the PIC or the local
+     APIC (see below).  An external interrupt handler cannot
+     sleep. */
+  external = is_external (frame->vec_no);
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (!intr_context ());
 
-      in_external_intr = true;
-      yield_on_return = false;
+      c = cpu_current ();
+      c->in_external_intr = true;
+      c->yield_on_return = false;
     }
 
   /* Invoke the interrupt's handler. */
-  handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
   else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
@@ -380,14 +513,93 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      c = cpu_current ();
+      c->in_external_intr = false;
+      if (frame->vec_no >= LAPIC_VEC_FIRST)
+        lapic_eoi ();
+      else
+        pic_end_of_interrupt (frame->vec_no); 
+
+      if (c->yield_on_return) 
+        {
+          c->yield_start = timer_cycles ();
+          c->yield_vec_no = frame->vec_no;
+          thread_yield (); 
+        }
+    }
+
+  /* Returning will turn interrupts back on, so release intr_lock
+     if we acquired it, unless the handler already turned
+     interrupts on itself. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF) 
+    {
+      off_end ();
+      spin_unlock (&intr_lock);
+    }
+}
+
+/* Notes that interrupts on the running CPU just went off, turned
+   off by the code at WHERE.  The caller must hold intr_lock. */
+static void
+off_begin (void *where) 
+{
+  struct cpu *c = cpu_current ();
+
+  c->off_start = timer_cycles ();
+  c->off_where = where;
+}
+
+/* Notes that interrupts on the running CPU are about to go back
+   on, and records how long they were off if that is the longest
+   yet.  The caller must hold intr_lock. */
+static void
+off_end (void) 
+{
+  struct cpu *c = cpu_current ();
 
-      if (yield_on_return) 
-        thread_yield (); 
+  if (c->off_start != 0) 
+    {
+      uint64_t cycles = timer_cycles () - c->off_start;
+      if (cycles > off_max) 
+        {
+          off_max = cycles;
+          off_max_where = c->off_where;
+        }
+      c->off_start = 0;
     }
 }
 
+/* Returns the longest time, in TSC cycles, that any CPU has run
+   with interrupts off since boot or the last call to
+   intr_off_reset(), or 0 if the CPU has no TSC. */
+uint64_t
+intr_off_max (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  uint64_t max = off_max;
+  intr_set_level (old_level);
+  return max;
+}
+
+/* Forgets the longest time with interrupts off so far. */
+void
+intr_off_reset (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  off_max = 0;
+  off_max_where = NULL;
+  intr_set_level (old_level);
+}
+
+/* Prints interrupt statistics. */
+void
+intr_print_stats (void) 
+{
+  if (off_max != 0)
+    printf ("Interrupts: off for at most %"PRIu64" cycles, "
+            "from code at %p\n", off_max, off_max_where);
+}
+
 /* Handles an unexpected interrupt with interrupt frame F.  An
    unexpected interrupt is one that has no registered handler. */
 static void
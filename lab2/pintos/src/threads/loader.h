@@ -12,6 +12,11 @@
    Must be aligned on a 4 MB boundary. */
 #define LOADER_PHYS_BASE 0xc0000000     /* 3 GB. */
 
+/* Physical address to which smp_init() copies the application
+   processors' startup code, ap-start.S.  A processor starts there
+   in real mode, so it must be page-aligned and below 1 MB. */
+#define AP_TRAMPOLINE 0x8000            /* 32 kB. */
+
 /* Important loader physical addresses. */
 #define LOADER_SIG (LOADER_END - LOADER_SIG_LEN)   /* 0xaa55 BIOS signature. */
 #define LOADER_PARTS (LOADER_SIG - LOADER_PARTS_LEN)     /* Partition table. */
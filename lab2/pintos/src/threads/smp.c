@@ -0,0 +1,332 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/fpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#endif
+
+/* Symmetric multiprocessing.
+
+   At boot, only the boot processor (BSP) runs; the other CPUs,
+   the application processors (APs), wait until the BSP sends
+   them an INIT interrupt and then a startup interrupt (SIPI),
+   which starts them in real mode at a page-aligned address below
+   1 MB.  smp_init() finds the APs in the MultiProcessor
+   Specification's configuration table, which the BIOS builds,
+   and starts them one at a time on the trampoline code in
+   ap-start.S.  See [MP] and [IA32-v3a] 8.4 "Multiple-Processor
+   (MP) Initialization".
+
+   Each AP then runs ap_main(), which sets it up much as main()
+   sets up the BSP and then turns it over to the scheduler.  From
+   then on every CPU schedules threads from run queues of its
+   own; see thread.c.  The CPUs share the kernel's data under a
+   single lock that each CPU holds while its interrupts are off;
+   see intr_lock in interrupt.c. */
+
+/* CPUs.  cpus[0] is the boot processor. */
+struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs running, including the boot processor. */
+unsigned cpu_cnt = 1;
+
+/* MP floating pointer structure.  See [MP] 4.1. */
+struct mp_float
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config;            /* Physical address of config table. */
+    uint8_t length;             /* Length in 16-byte units. */
+    uint8_t version;            /* Specification revision. */
+    uint8_t checksum;           /* All bytes must add up to 0. */
+    uint8_t features[5];        /* Feature bytes. */
+  } __attribute__ ((packed));
+
+/* MP configuration table header.  See [MP] 4.2. */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Length of table, header included. */
+    uint8_t version;            /* Specification revision. */
+    uint8_t checksum;           /* All bytes must add up to 0. */
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_length;
+    uint16_t entry_cnt;         /* Number of entries after header. */
+    uint32_t lapic_addr;        /* Local APIC physical address. */
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+  } __attribute__ ((packed));
+
+/* MP configuration table processor entry.  See [MP] 4.3.1.
+   Entries of every other type are 8 bytes long. */
+struct mp_processor
+  {
+    uint8_t type;               /* MP_PROCESSOR. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    uint8_t apic_version;
+    uint8_t flags;              /* MP_CPU_* flags. */
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+  } __attribute__ ((packed));
+
+#define MP_PROCESSOR 0          /* Processor entry type. */
+#define MP_CPU_ENABLED 0x01     /* Processor is usable. */
+#define MP_CPU_BSP 0x02         /* Processor is the boot processor. */
+
+/* Trampoline code and its arguments, in ap-start.S. */
+extern const char ap_start[], ap_start_end[];
+extern uint32_t ap_start_args[3];
+
+static const struct mp_config *find_mp_config (void);
+static const struct mp_float *search_mp_float (uintptr_t paddr,
+                                               size_t size);
+static bool checksum_ok (const void *, size_t size);
+static bool start_ap (struct cpu *, uint32_t *page_dir);
+static void ap_main (void) NO_RETURN;
+static intr_handler_func resched_interrupt;
+
+/* Starts the application processors listed in the MP
+   configuration table, up to CPU_MAX CPUs in all.  Must be
+   called by the boot processor, with interrupts on, after
+   timer_calibrate(). */
+void
+smp_init (void)
+{
+  const struct mp_config *config;
+  const uint8_t *p, *end;
+  uint32_t *page_dir;
+  unsigned i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (!lapic_present ())
+    return;
+  cpus[0].apic_id = lapic_id ();
+  config = find_mp_config ();
+  if (config == NULL)
+    return;
+
+  intr_register_ext (LAPIC_VEC_RESCHED, resched_interrupt, "Reschedule IPI");
+
+  /* Copy the trampoline to where the APs start.  Until each AP
+     loads the kernel's page directory, it runs on a copy of it
+     that also maps the first 4 MB of physical memory at virtual
+     address 0, where the trampoline turns on paging. */
+  memcpy (ptov (AP_TRAMPOLINE), ap_start, ap_start_end - ap_start);
+  page_dir = palloc_get_page (PAL_ASSERT);
+  memcpy (page_dir, init_page_dir, PGSIZE);
+  page_dir[0] = page_dir[pd_no (PHYS_BASE)];
+
+  p = (const uint8_t *) (config + 1);
+  end = (const uint8_t *) config + config->length;
+  for (i = 0; i < config->entry_cnt && p < end; i++)
+    {
+      const struct mp_processor *proc = (const struct mp_processor *) p;
+      struct cpu *c;
+
+      if (proc->type != MP_PROCESSOR)
+        {
+          p += 8;
+          continue;
+        }
+      p += sizeof *proc;
+
+      if (!(proc->flags & MP_CPU_ENABLED) || (proc->flags & MP_CPU_BSP)
+          || proc->apic_id == cpus[0].apic_id)
+        continue;
+      if (cpu_cnt >= CPU_MAX)
+        {
+          printf ("SMP: more than %d CPUs, ignoring the rest.\n", CPU_MAX);
+          break;
+        }
+
+      c = &cpus[cpu_cnt];
+      c->id = cpu_cnt;
+      c->apic_id = proc->apic_id;
+      if (!start_ap (c, page_dir))
+        {
+          /* The AP may still be running on the temporary page
+             directory, so it must not be freed. */
+          printf ("SMP: CPU with APIC ID %"PRIu8" failed to start.\n",
+                  proc->apic_id);
+          return;
+        }
+    }
+  palloc_free_page (page_dir);
+
+  printf ("SMP: %u CPU%s running.\n", cpu_cnt, cpu_cnt != 1 ? "s" : "");
+
+  /* With more than one CPU, the boot CPU's tick cannot stop while
+     it is idle, since the others still need the tick count. */
+  if (cpu_cnt > 1 && timer_tickless)
+    {
+      timer_tickless = false;
+      printf ("SMP: tickless idle disabled.\n");
+    }
+}
+
+/* Interrupts CPU C so that it reschedules, when it returns from
+   the interrupt.  Interrupts must be off. */
+void
+smp_reschedule (struct cpu *c)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (c != cpu_current ());
+
+  lapic_send_ipi (c->apic_id, LAPIC_VEC_RESCHED);
+}
+
+/* Starts application processor C with the temporary page
+   directory PAGE_DIR and waits up to a second for it to start
+   scheduling threads.  Returns true if it did, false otherwise. */
+static bool
+start_ap (struct cpu *c, uint32_t *page_dir)
+{
+  uint32_t *args;
+  struct thread *idle;
+  int64_t start;
+  int i;
+
+  idle = thread_prepare_ap (c);
+  if (idle == NULL)
+    return false;
+
+  args = ptov (AP_TRAMPOLINE + ((const char *) ap_start_args - ap_start));
+  args[0] = vtop (page_dir);
+  args[1] = (uint32_t) idle + PGSIZE;
+  args[2] = (uint32_t) ap_main;
+
+  /* Send INIT, then two startup IPIs, as [MP] B.4 says.  The
+     startup IPI's vector is the trampoline's page number. */
+  intr_disable ();
+  lapic_send_init (c->apic_id);
+  intr_enable ();
+  timer_mdelay (10);
+  for (i = 0; i < 2 && !c->started; i++)
+    {
+      intr_disable ();
+      lapic_send_startup (c->apic_id, AP_TRAMPOLINE);
+      intr_enable ();
+      timer_udelay (200);
+    }
+
+  /* Wait with interrupts on, so that the AP can take the lock
+     that every CPU holds with interrupts off. */
+  start = timer_ticks ();
+  while (!c->started && timer_elapsed (start) < TIMER_FREQ)
+    barrier ();
+  if (!c->started)
+    return false;
+
+  intr_disable ();
+  cpu_cnt++;
+  intr_enable ();
+  return true;
+}
+
+/* Entry point of an application processor, called by the
+   trampoline on its idle thread's stack with paging on and
+   interrupts off. */
+static void
+ap_main (void)
+{
+  /* Switch to the kernel's own page directory and take part in
+     interrupt handling, which takes the lock. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+  intr_init_ap ();
+  fpu_init_ap ();
+#ifdef USERPROG
+  gdt_init_ap (cpu_current ()->id);
+#endif
+  lapic_init_ap ();
+  timer_init_ap ();
+
+  thread_start_ap ();
+}
+
+/* Returns the MP configuration table, or a null pointer if there
+   is none or it is invalid. */
+static const struct mp_config *
+find_mp_config (void)
+{
+  const struct mp_float *mpf = NULL;
+  const struct mp_config *config;
+  uint16_t ebda_seg, base_kb;
+
+  /* [MP] 4 says to look in the first kB of the Extended BIOS Data
+     Area, whose segment is at 0x40e, in the last kB of base
+     memory, whose size in kB is at 0x413, and in the BIOS ROM
+     between 0xf0000 and 0xfffff. */
+  ebda_seg = *(const uint16_t *) ptov (0x40e);
+  base_kb = *(const uint16_t *) ptov (0x413);
+  if (ebda_seg != 0)
+    mpf = search_mp_float ((uintptr_t) ebda_seg << 4, 1024);
+  if (mpf == NULL && base_kb != 0)
+    mpf = search_mp_float ((uintptr_t) (base_kb - 1) * 1024, 1024);
+  if (mpf == NULL)
+    mpf = search_mp_float (0xf0000, 0x10000);
+  if (mpf == NULL || mpf->config == 0)
+    return NULL;
+
+  if (mpf->config >= init_ram_pages * PGSIZE)
+    return NULL;
+  config = ptov (mpf->config);
+  if (memcmp (config->signature, "PCMP", 4)
+      || !checksum_ok (config, config->length))
+    return NULL;
+  return config;
+}
+
+/* Searches SIZE bytes starting at physical address PADDR for a
+   valid MP floating pointer structure, which is aligned on a
+   16-byte boundary.  Returns it if found, otherwise a null
+   pointer. */
+static const struct mp_float *
+search_mp_float (uintptr_t paddr, size_t size)
+{
+  const uint8_t *p, *end;
+
+  if (paddr + size > init_ram_pages * PGSIZE)
+    return NULL;
+
+  end = (const uint8_t *) ptov (paddr) + size;
+  for (p = ptov (paddr); p + sizeof (struct mp_float) <= end; p += 16)
+    if (!memcmp (p, "_MP_", 4) && checksum_ok (p, sizeof (struct mp_float)))
+      return (const struct mp_float *) p;
+  return NULL;
+}
+
+/* Returns true if the SIZE bytes at P add up to 0, modulo 256. */
+static bool
+checksum_ok (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *p++;
+  return sum == 0;
+}
+
+/* Reschedule IPI handler.  Another CPU made a thread ready on
+   this one that should run ahead of the running thread. */
+static void
+resched_interrupt (struct intr_frame *args UNUSED)
+{
+  intr_yield_on_return ();
+}
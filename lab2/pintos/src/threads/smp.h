@@ -0,0 +1,78 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+#include <list.h>
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Maximum number of CPUs. */
+#define CPU_MAX 8
+
+/* A CPU.
+
+   The boot CPU is cpus[0]; the other CPUs, if any, follow in
+   the order in which smp_init() found them.  Most members belong
+   to the scheduler and the interrupt core, and each is only
+   accessed by its own CPU or with interrupts off. */
+struct cpu
+  {
+    unsigned id;                        /* Index in cpus[]. */
+    uint8_t apic_id;                    /* Local APIC ID. */
+    volatile bool started;              /* Scheduling threads yet? */
+
+    /* Owned by thread.c. */
+    struct thread *idle_thread;         /* Runs when nothing else can. */
+    struct thread *running;             /* Thread running on it. */
+    struct list ready_lists[PRI_CNT];   /* Run queues, one per priority. */
+    uint64_t ready_mask;                /* Bit P set if ready_lists[P]
+                                           is nonempty. */
+    int ready_cnt;                      /* # of threads in run queues. */
+    struct rbtree fair_tree;            /* Run queue for the CFS and
+                                           stride scheduler. */
+    int64_t cfs_weight;                 /* Total weight in fair_tree. */
+    int64_t min_vruntime;               /* CFS virtual time. */
+    int64_t stride_tickets;             /* Total tickets in fair_tree. */
+    int64_t global_pass;                /* Stride virtual time. */
+    struct list dl_ready;               /* Ready EDF threads, in order
+                                           of deadline. */
+    struct list dl_throttled;           /* EDF threads out of budget. */
+    int dl_cnt;                         /* # of threads in dl_ready. */
+    int64_t dl_bw;                      /* Share of CPU admitted to EDF
+                                           threads, of DL_BW_ONE. */
+    int64_t exec_start;                 /* Time `running' was last
+                                           charged, in ns. */
+    unsigned thread_ticks;              /* # of timer ticks since last
+                                           yield. */
+    bool handoff;                       /* Thread switched to takes over
+                                           the time slice? */
+    unsigned balance_ticks;             /* # of timer ticks since last
+                                           rebalancing. */
+    int64_t idle_ticks;                 /* # of timer ticks spent idle. */
+    int64_t migrations;                 /* # of threads taken from other
+                                           CPUs. */
+
+    /* Owned by interrupt.c. */
+    bool in_external_intr;              /* In an external interrupt? */
+    bool yield_on_return;               /* Yield on interrupt return? */
+    uint64_t yield_start;               /* TSC at start of that yield. */
+    uint8_t yield_vec_no;               /* Interrupt that yielded. */
+    uint64_t off_start;                 /* TSC when interrupts went off,
+                                           or 0 if not known. */
+    void *off_where;                    /* Code that turned them off. */
+
+    /* Owned by fpu.c. */
+    struct thread *fpu_last;            /* Thread whose FPU state was
+                                           last loaded. */
+  };
+
+extern struct cpu cpus[CPU_MAX];
+extern unsigned cpu_cnt;
+
+struct cpu *cpu_current (void);
+
+void smp_init (void);
+void smp_reschedule (struct cpu *);
+
+#endif /* threads/smp.h */
@@ -0,0 +1,77 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Spin lock, for mutual exclusion between CPUs.
+
+   A CPU that finds the lock held busy-waits until it is free.
+   Spin locks are meant for short critical sections that must
+   not sleep, usually with interrupts off, since an interrupt
+   handler on the CPU that holds the lock could otherwise spin
+   forever waiting for it.  Use a struct lock (see synch.h) to
+   protect anything longer. */
+struct spinlock
+  {
+    volatile uint32_t locked;   /* 1 if held, 0 if free. */
+  };
+
+/* Initializers for a free and a held spin lock. */
+#define SPINLOCK_INITIALIZER { 0 }
+#define SPINLOCK_LOCKED { 1 }
+
+/* Atomically stores 1 in LOCK and returns its previous value.
+   XCHG with a memory operand is always locked.  See [IA32-v2b]
+   "XCHG". */
+static inline uint32_t
+spin_xchg (struct spinlock *lock)
+{
+  uint32_t value = 1;
+  asm volatile ("xchgl %0, %1"
+                : "+r" (value), "+m" (lock->locked) : : "memory");
+  return value;
+}
+
+/* Initializes LOCK as free. */
+static inline void
+spin_init (struct spinlock *lock)
+{
+  lock->locked = 0;
+}
+
+/* Acquires LOCK, if it is free, and returns true, or returns
+   false at once if it is held. */
+static inline bool
+spin_trylock (struct spinlock *lock)
+{
+  return spin_xchg (lock) == 0;
+}
+
+/* Acquires LOCK, busy-waiting until it is free.  While it is
+   held, the CPU only reads it, without locking the bus, and
+   PAUSE tells the CPU that it is in a spin-wait loop. */
+static inline void
+spin_lock (struct spinlock *lock)
+{
+  while (spin_xchg (lock) != 0)
+    while (lock->locked)
+      asm volatile ("pause");
+}
+
+/* Releases LOCK.  An ordinary store suffices, since x86 never
+   makes a store visible before earlier loads and stores. */
+static inline void
+spin_unlock (struct spinlock *lock)
+{
+  asm volatile ("movl $0, %0" : "=m" (lock->locked) : : "memory");
+}
+
+/* Returns true if LOCK is held, by any CPU. */
+static inline bool
+spin_locked (const struct spinlock *lock)
+{
+  return lock->locked != 0;
+}
+
+#endif /* threads/spinlock.h */
@@ -31,6 +31,18 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Maximum length of a chain of priority donations.  A thread
+   waiting for a lock donates its priority to the lock's holder,
+   and if that thread is itself waiting for a lock, on to that
+   lock's holder, and so on, up to this many threads.  Bounding
+   the chain bounds the time spent in lock_acquire() with
+   interrupts off.  Ticket transfers follow the same chains. */
+#define DONATION_DEPTH_MAX 8
+
+static void donate_priority (struct lock *);
+static void transfer_tickets (struct lock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -102,7 +114,9 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up one thread of those waiting for SEMA, if any: the
+   one with the highest priority, or the one that has waited
+   longest among those with equal priorities.
 
    This function may be called from an interrupt handler. */
 void
@@ -114,10 +128,20 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      struct list_elem *e = list_max (&sema->waiters, thread_priority_less,
+                                      NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+      thread_hand_off (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+
+  /* Let the thread we woke run now if it has a higher priority,
+     unless interrupts were already off. */
+  if (old_level == INTR_ON || intr_context ())
+    thread_preempt ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -185,6 +209,14 @@ lock_init (struct lock *lock)
    necessary.  The lock must not already be held by the current
    thread.
 
+   While it waits, the current thread donates its priority to
+   the lock's holder, and through any chain of locks that the
+   holder is waiting for in turn, so that a lower-priority holder
+   cannot keep it waiting behind threads of intermediate
+   priority.  (Not with the MLFQS, which sets priorities
+   itself.)  Under the stride scheduler, it likewise lends its
+   tickets to the holders along the chain.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +224,82 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t wait_start = 0;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  if (lock->holder != NULL) 
+    {
+      cur->waiting_lock = lock;
+      wait_start = timer_now_ns ();
+      if (!thread_mlfqs)
+        donate_priority (lock);
+      if (thread_stride)
+        transfer_tickets (lock);
+    }
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  if (cur->waiting_lock != NULL)
+    cur->lock_wait_ns += timer_now_ns () - wait_start;
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back (&cur->held_locks, &lock->elem);
+
+  /* Threads still waiting for LOCK now lend their tickets to us. */
+  if (thread_stride)
+    thread_update_tickets (cur);
+  intr_set_level (old_level);
+}
+
+/* Donates the current thread's priority to the holder of LOCK,
+   then to the holder of the lock that thread is waiting for, and
+   so on along the chain, stopping at a thread that already has
+   at least that priority or after DONATION_DEPTH_MAX threads. */
+static void
+donate_priority (struct lock *lock) 
+{
+  int priority = thread_current ()->priority;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++) 
+    {
+      struct thread *holder;
+
+      if (lock == NULL || lock->holder == NULL)
+        break;
+      holder = lock->holder;
+      if (holder->priority >= priority)
+        break;
+      thread_donate_priority (holder, priority);
+      lock = holder->waiting_lock;
+    }
+}
+
+/* Lends the current thread's tickets to the holder of LOCK, and
+   on along the chain of locks that holders are waiting for, up
+   to DONATION_DEPTH_MAX threads.  lock_release() takes them back
+   by recounting the releasing thread's tickets. */
+static void
+transfer_tickets (struct lock *lock) 
+{
+  int tickets = thread_current ()->tickets;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++) 
+    {
+      if (lock == NULL || lock->holder == NULL)
+        break;
+      thread_transfer_tickets (lock->holder, tickets);
+      lock = lock->holder->waiting_lock;
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -209,18 +311,28 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) 
+    {
+      lock->holder = thread_current ();
+      list_push_back (&lock->holder->held_locks, &lock->elem);
+    }
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives up any priority donated through LOCK, keeping what was
+   donated through other locks the thread still holds, and yields
+   if that leaves a ready thread with a higher priority.  Likewise
+   gives back tickets lent through LOCK.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,11 +340,27 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  /* Wake the next holder before dropping our donated priority,
+     so that no thread of intermediate priority can run in
+     between. */
+  old_level = intr_disable ();
   lock->holder = NULL;
+  list_remove (&lock->elem);
   sema_up (&lock->semaphore);
+  if (!thread_mlfqs)
+    thread_update_priority (cur);
+  if (thread_stride)
+    thread_update_tickets (cur);
+  intr_set_level (old_level);
+
+  if (old_level == INTR_ON)
+    thread_preempt ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -251,8 +379,12 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
+static bool waiter_priority_less (const struct list_elem *,
+                                  const struct list_elem *, void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,6 +427,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -302,8 +435,10 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals one of them to wake up from its wait:
+   the one with the highest priority, or the one that has waited
+   longest among those with equal priorities.  LOCK must be held
+   before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -317,8 +452,26 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters, waiter_priority_less,
+                                      NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
+}
+
+/* Returns true if the thread waiting on condition variable
+   waiter A_ has a lower priority than the one waiting on B_. */
+static bool
+waiter_priority_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED) 
+{
+  const struct semaphore_elem *a = list_entry (a_, struct semaphore_elem,
+                                               elem);
+  const struct semaphore_elem *b = list_entry (b_, struct semaphore_elem,
+                                               elem);
+
+  return a->thread->priority < b->thread->priority;
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -1,16 +1,20 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,16 +24,46 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of all processes.  Processes are added to this list
-   when they are first scheduled and removed when they exit. */
-static struct list all_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Run queues.  Each CPU has, for each priority, a list of the
+   processes of that priority in THREAD_READY state, that is,
+   processes that are ready to run but not actually running, and
+   it only runs threads from its own run queues.  Bit P of a
+   CPU's ready_mask is set if and only if its ready_lists[P] is
+   not empty, so that finding the highest-priority ready thread
+   takes constant time however many threads are ready.  See
+   struct cpu in smp.h.
+
+   A new thread goes to the least loaded CPU, and a thread that
+   becomes ready again goes back to the CPU that it last ran on,
+   whose caches may still hold its data.  Threads move between
+   CPUs only when the load gets out of balance: a CPU that runs
+   out of ready threads takes half of the ready threads of the
+   busiest other CPU, and every BALANCE_TICKS each CPU evens out
+   its load with the busiest one.  See balance().
+
+   Under the completely fair scheduler and the stride scheduler,
+   each CPU instead keeps its ready threads in a red-black tree,
+   ordered by virtual run time or pass, and the priority lists
+   stay empty.  See cfs_update() and stride_tick().
+
+   Whatever the scheduler, threads in the earliest deadline first
+   (EDF) class go in a separate queue, dl_ready, and run ahead of
+   all others.  See thread_set_deadline(). */
+
+/* Threads, on one list for each set of threads, in no
+   particular order.  A thread joins the blocked set when it is
+   created, moves between sets as it blocks and wakes up, and
+   leaves the dying set when it is destroyed.  Keeping the sets
+   apart lets code that cares only about runnable threads, such
+   as the MLFQS update every second, skip the blocked ones,
+   however many there are.  Accessed only with interrupts off. */
+static struct list thread_sets[THREADS_SET_CNT];
+
+/* Threads that have not exited, hashed by tid, for
+   thread_lookup().  The table does not grow, so that it can be
+   used with interrupts off, when malloc() cannot be called. */
+#define TID_BUCKETS 64
+static struct list tid_buckets[TID_BUCKETS];
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -37,6 +71,18 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Pages of dead threads, kept for reuse by thread_create() so
+   that creating a thread does not have to take a page from the
+   page allocator, which zeroes it, and exiting does not have to
+   give it back.  Only the struct thread at the start of a reused
+   page is reinitialized; the stack above it starts out with
+   whatever the dead thread left there.  Accessed only with
+   interrupts off. */
+#define PAGE_CACHE_SIZE 32      /* Most pages kept. */
+static void *page_cache[PAGE_CACHE_SIZE];
+static size_t page_cache_cnt;   /* Number of pages in cache. */
+static long long page_cache_hits; /* # of pages reused. */
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -49,34 +95,212 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long context_switches; /* # of switches between threads. */
+static long long handoffs;      /* # of switches by thread_hand_off(). */
+static struct latency_hist wakeup_latency; /* Over all threads. */
 
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+#define TIME_SLICE_US 40000     /* # of microseconds to give each thread. */
+static unsigned time_slice;     /* TIME_SLICE_US in timer ticks. */
+
+/* Load balancing. */
+#define BALANCE_TICKS 16        /* # of timer ticks between rebalancing. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler (CFS).
+
+   Each thread accumulates virtual run time (vruntime): the time
+   it has run, in nanoseconds, scaled down by its weight relative
+   to a nice-0 thread's.  The ready thread with the least vruntime
+   runs next.  Rather than a fixed time slice, each CPU divides a
+   scheduling period of CFS_LATENCY_NS among its threads in
+   proportion to their weights, stretching the period so that no
+   slice falls below CFS_MIN_GRANULARITY_NS.  Preemption happens
+   only on timer ticks and wake-ups, so slices are rounded up to
+   whole ticks in practice.
+
+   A thread that wakes up after sleeping gets back to within half
+   a period of the CPU's min_vruntime, so that it runs soon but
+   cannot claim the CPU for as long as it slept. */
+#define CFS_LATENCY_NS 40000000         /* Target scheduling period. */
+#define CFS_MIN_GRANULARITY_NS 5000000  /* Shortest slice. */
+#define CFS_WAKEUP_GRANULARITY_NS 5000000 /* vruntime lead needed to
+                                             preempt on wake-up. */
+#define CFS_NICE_0_WEIGHT 1024          /* Weight at nice 0. */
+
+/* If true, use the stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+/* If true, a thread that wakes another and then blocks hands
+   the rest of its time slice to the thread it woke, which runs
+   next instead of waiting its turn in the run queue, as long as
+   no thread that the scheduler would choose ahead of it is
+   ready.  Then a pair of threads that take turns, each waking
+   the other and waiting for it, get through a round trip in two
+   thread switches, however many other threads are ready.
+   Controlled by kernel command-line option "-handoff".  See
+   thread_hand_off(). */
+bool thread_handoff;
+
+/* Stride scheduler.
+
+   Each thread holds tickets, and gets a share of its CPU in
+   proportion to them.  A thread's stride is STRIDE1 divided by
+   its tickets, and its pass advances by its stride for every
+   timer tick it runs.  The ready thread with the least pass runs
+   next, and the running thread yields on a tick as soon as
+   another has a lesser pass, so that over any stretch of ticks
+   each thread's share is within a tick or so of exact.
+
+   Each CPU's global pass advances by STRIDE1 divided by its total
+   tickets on every tick.  A thread that blocks remembers how far
+   its pass was from the global pass, and gets the same distance
+   back when it wakes, so that it neither loses its place nor
+   banks the time it spent blocked.
+
+   A thread that waits for a lock lends its tickets to the holder
+   for as long as it waits.  See thread_transfer_tickets(). */
+#define STRIDE1 (1 << 20)               /* Stride of a single ticket. */
+
+/* Earliest deadline first class.
+
+   A thread joins the class with thread_set_deadline(), asking
+   for RUNTIME ticks of its CPU in every PERIOD ticks, done within
+   DEADLINE ticks of the start of the period.  Each period is a
+   job: the thread calls thread_wait_period() when it finishes
+   one, to sleep until the next period.  Ready EDF threads run
+   before all other threads, the one whose job has the earliest
+   deadline first.
+
+   Admission control keeps the CPU from being promised away: the
+   sum of RUNTIME / DEADLINE over a CPU's EDF threads may not
+   exceed DL_BW_MAX, under which EDF meets every deadline and the
+   other threads keep the rest of the CPU.  EDF threads do not
+   move between CPUs, so that what was admitted stays true.
+
+   A thread that uses up its RUNTIME before its job is done is
+   throttled: it does not run again until its next period, when
+   its unfinished job counts as having missed its deadline.  Each
+   thread counts its misses, and reports them when it exits. */
+#define DL_BW_ONE (1 << 20)             /* All of a CPU. */
+#define DL_BW_MAX (DL_BW_ONE / 100 * 95) /* Most admitted to EDF. */
+
+/* Weights for nice values NICE_MIN...NICE_MAX.  Each step in nice
+   changes the weight by about 25%, so that a thread gets about
+   10% more or less of the CPU than another thread one step away
+   from it. */
+static const int cfs_weights[NICE_MAX - NICE_MIN + 1] = 
+  {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+    /*  20 */ 12,
+  };
+
+/* Multi-level feedback queue scheduler.  See mlfqs_tick(). */
+static fixed_point load_avg;    /* System load average. */
+static fixed_point cpu_per_tick; /* recent_cpu charged per tick. */
+
+/* Threads charged recent_cpu since their priorities were last
+   recomputed, so that the recomputation every time slice touches
+   only the threads that ran in it. */
+static struct list cpu_dirty_list;
+
+/* Blocked threads, for the MLFQS.  Decaying every blocked
+   thread's recent_cpu once a second would make the update take
+   time in proportion to the number of threads, with interrupts
+   off.  Instead, a blocked thread waits in mlfqs_blocked[], in
+   the bucket for the second it blocked in, modulo MLFQS_HISTORY,
+   and each second only one bucket is brought up to date, with
+   the decay factors of the last MLFQS_HISTORY seconds, which
+   mlfqs_coeffs[] keeps.  A thread that wakes up catches up on
+   the seconds since its bucket was last visited.  Meanwhile its
+   priority, which orders it among the waiters for a semaphore,
+   may be up to MLFQS_HISTORY seconds stale. */
+#define MLFQS_HISTORY 8
+static struct list mlfqs_blocked[MLFQS_HISTORY];
+static fixed_point mlfqs_coeffs[MLFQS_HISTORY]; /* By second, modulo
+                                                   MLFQS_HISTORY. */
+static int64_t mlfqs_second;    /* # of once-a-second updates. */
+
 static void kernel_thread (thread_func *, void *aux);
 
+static void block (enum thread_set);
+static void move_thread (struct thread *, enum thread_set);
+
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static void init_cpu (struct cpu *);
+static struct cpu *least_loaded_cpu (void);
+static bool is_idle (const struct thread *);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static void set_priority (struct thread *, int);
+static int ready_max_priority (const struct cpu *);
+static struct thread *ready_peek (struct cpu *);
+static bool should_preempt (const struct cpu *, const struct thread *);
+static bool ready_preempts (struct cpu *);
+static int cpu_load (const struct cpu *);
+static bool balance (struct cpu *, bool idle);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_seconds (int64_t seconds, int ready);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_decay (struct thread *, fixed_point decay,
+                         fixed_point carry);
+static void mlfqs_visit_bucket (void);
+static void mlfqs_block (struct thread *);
+static void mlfqs_unblock (struct thread *);
+static int cfs_weight (const struct thread *);
+static void cfs_update (struct cpu *);
+static void cfs_tick (struct cpu *, struct thread *);
+static int64_t cfs_slice (const struct cpu *, const struct thread *);
+static bool cfs_less (const struct rb_elem *, const struct rb_elem *,
+                      void *aux);
+static bool fair_sched (void);
+static void set_tickets (struct thread *, int);
+static void stride_tick (struct cpu *, struct thread *);
+static bool stride_less (const struct rb_elem *, const struct rb_elem *,
+                         void *aux);
+static void dl_tick (struct cpu *, struct thread *);
+static void dl_new_job (struct thread *, int64_t release);
+static bool dl_less (const struct list_elem *, const struct list_elem *,
+                     void *aux);
+static void latency_record (struct latency_hist *, int64_t ns);
+static void latency_print (const char *name, const struct latency_hist *);
+static void print_thread_stats (struct thread *, void *aux);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
+static struct thread *handoff_target (struct thread *);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
-static tid_t allocate_tid (void);
+static tid_t allocate_tid (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queue, the thread sets, and the tid
+   lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -87,17 +311,54 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
-  list_init (&all_list);
+  init_cpu (&cpus[0]);
+  for (i = 0; i < THREADS_SET_CNT; i++)
+    list_init (&thread_sets[i]);
+  for (i = 0; i < TID_BUCKETS; i++)
+    list_init (&tid_buckets[i]);
+  list_init (&cpu_dirty_list);
+  for (i = 0; i < MLFQS_HISTORY; i++)
+    list_init (&mlfqs_blocked[i]);
+  time_slice = DIV_ROUND_UP (TIME_SLICE_US * TIMER_FREQ, 1000 * 1000);
+
+  /* recent_cpu counts 100 Hz ticks whatever the timer frequency,
+     so that the MLFQS behaves the same at every frequency. */
+  cpu_per_tick = fix_frac (TIMER_FREQ_DEFAULT, TIMER_FREQ);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
-  initial_thread->tid = allocate_tid ();
+  initial_thread->cpu = &cpus[0];
+  cpus[0].running = initial_thread;
+  move_thread (initial_thread, THREADS_RUNNABLE);
+  allocate_tid (initial_thread);
+}
+
+/* Initializes C's run queues. */
+static void
+init_cpu (struct cpu *c) 
+{
+  int i;
+
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&c->ready_lists[i]);
+  c->ready_mask = 0;
+  c->ready_cnt = 0;
+  rb_init (&c->fair_tree, thread_stride ? stride_less : cfs_less, NULL);
+  c->cfs_weight = 0;
+  c->min_vruntime = 0;
+  c->stride_tickets = 0;
+  c->global_pass = 0;
+  list_init (&c->dl_ready);
+  list_init (&c->dl_throttled);
+  c->dl_cnt = 0;
+  c->dl_bw = 0;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -111,40 +372,630 @@ thread_start (void)
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
   /* Start preemptive thread scheduling. */
+  cpus[0].started = true;
   intr_enable ();
 
   /* Wait for the idle thread to initialize idle_thread. */
   sema_down (&idle_started);
 }
 
+/* Prepares application processor C to run threads: initializes
+   its run queues and creates its idle thread, which the
+   processor runs from the moment it starts.  Returns the idle
+   thread, whose page holds the processor's initial stack.  Must
+   not be called with interrupts off. */
+struct thread *
+thread_prepare_ap (struct cpu *c) 
+{
+  struct thread *t;
+  char name[16];
+  enum intr_level old_level;
+
+  ASSERT (c != &cpus[0]);
+
+  t = palloc_get_page (PAL_ZERO);
+  if (t == NULL)
+    return NULL;
+
+  snprintf (name, sizeof name, "idle%u", c->id);
+  init_thread (t, name, PRI_MIN);
+  allocate_tid (t);
+  t->status = THREAD_RUNNING;
+  t->cpu = c;
+
+  init_cpu (c);
+  c->idle_thread = c->running = t;
+
+  old_level = intr_disable ();
+  move_thread (t, THREADS_RUNNABLE);
+  intr_set_level (old_level);
+  return t;
+}
+
+/* Called by an application processor, with interrupts off, once
+   it has been set up, to start scheduling threads.  Runs its
+   idle thread. */
+void
+thread_start_ap (void) 
+{
+  struct cpu *c = cpu_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (running_thread () == c->idle_thread);
+
+  c->started = true;
+  c->idle_thread->run_start_ns = timer_now_ns ();
+  idle_loop ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void) 
 {
+  struct cpu *c = cpu_current ();
   struct thread *t = thread_current ();
 
   /* Update statistics. */
-  if (t == idle_thread)
-    idle_ticks++;
+  if (t == c->idle_thread) 
+    {
+      idle_ticks++;
+      c->idle_ticks++;
+    }
 #ifdef USERPROG
-  else if (t->pagedir != NULL)
-    user_ticks++;
+  else if (t->pagedir != NULL) 
+    {
+      user_ticks++;
+      t->user_ticks++;
+    }
 #endif
+  else 
+    {
+      kernel_ticks++;
+      t->kernel_ticks++;
+    }
+
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
+  /* Even out the load with the other CPUs now and then.  An
+     idle CPU looks for work every time it wakes up anyway. */
+  if (++c->balance_ticks >= BALANCE_TICKS) 
+    {
+      c->balance_ticks = 0;
+      if (balance (c, false) && ready_preempts (c))
+        intr_yield_on_return ();
+    }
+
+  /* Enforce preemption.  An EDF thread runs until its budget
+     runs out or a thread with an earlier deadline is ready. */
+  if (t->dl_period != 0 || !list_empty (&c->dl_throttled))
+    dl_tick (c, t);
+  if (t->dl_period == 0) 
+    {
+      if (thread_cfs)
+        cfs_tick (c, t);
+      else if (thread_stride)
+        stride_tick (c, t);
+      else if (++c->thread_ticks >= time_slice)
+        intr_yield_on_return ();
+    }
+}
+
+/* Accounts for TICKS timer ticks that passed without a timer
+   interrupt while the idle thread had the CPU halted with the
+   periodic tick stopped.  See timer_idle_enter(). */
+void
+thread_idle_ticks (int64_t ticks) 
+{
+  idle_ticks += ticks;
+  cpus[0].idle_ticks += ticks;
+
+  /* Catch up on the once-a-second MLFQS updates that fell in
+     that time, during which no thread was ready. */
+  if (thread_mlfqs) 
+    {
+      int64_t now = timer_ticks ();
+      int64_t seconds = now / TIMER_FREQ - (now - ticks) / TIMER_FREQ;
+      if (seconds > 0)
+        mlfqs_seconds (seconds, 0);
+    }
+}
+
+/* Does the MLFQS bookkeeping for a timer tick during which T was
+   running.  T's recent_cpu goes up by one (100 Hz) tick.  Once
+   a second, the load average and every thread's recent_cpu and
+   priority are updated.  Otherwise, once every time slice, only
+   the threads whose recent_cpu went up since the last update get
+   their priority recomputed, so that the cost of a tick does not
+   grow with the number of threads.  The periodic updates follow
+   the boot CPU's tick, which drives the tick count. */
+static void
+mlfqs_tick (struct thread *t) 
+{
+  struct cpu *c = cpu_current ();
+  int64_t now = timer_ticks ();
+
+  ASSERT (intr_context ());
+
+  if (!is_idle (t)) 
+    {
+      t->recent_cpu = fix_add (t->recent_cpu, cpu_per_tick);
+      if (!t->cpu_dirty) 
+        {
+          t->cpu_dirty = true;
+          list_push_back (&cpu_dirty_list, &t->cpu_dirty_elem);
+        }
+    }
+
+  /* Only the boot CPU's tick advances the tick count, so only it
+     runs the periodic updates. */
+  if (c == &cpus[0]) 
+    {
+      if (now % TIMER_FREQ == 0) 
+        {
+          int ready = 0;
+          unsigned i;
+
+          for (i = 0; i < cpu_cnt; i++)
+            ready += cpus[i].ready_cnt + !is_idle (cpus[i].running);
+          mlfqs_seconds (1, ready);
+        }
+      else if (now % time_slice == 0) 
+        while (!list_empty (&cpu_dirty_list)) 
+          {
+            struct thread *d = list_entry (list_pop_front (&cpu_dirty_list),
+                                           struct thread, cpu_dirty_elem);
+            d->cpu_dirty = false;
+            set_priority (d, mlfqs_priority (d));
+          }
+    }
+
+  if (ready_preempts (c))
+    intr_yield_on_return ();
+}
+
+/* Applies SECONDS once-a-second MLFQS updates, each with READY
+   threads ready or running: decays the load average toward READY,
+   then decays every thread's recent_cpu by a factor that depends
+   on the load average and adds its nice value, and recomputes
+   every thread's priority.  Blocked threads are brought up to
+   date a bucket at a time; see mlfqs_blocked.
+
+   Several seconds are folded into a single pass over the runnable
+   threads: after the updates with factors c1...ck, recent_cpu is
+   (ck*...*c1) * recent_cpu + (1 + ck + ck*ck-1 + ...) * nice. */
+static void
+mlfqs_seconds (int64_t seconds, int ready) 
+{
+  fixed_point decay = FIX_ONE;
+  fixed_point carry = 0;
+  int zero_seconds = 0;
+  struct list *runnable = &thread_sets[THREADS_RUNNABLE];
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (seconds-- > 0) 
+    {
+      fixed_point twice_load;
+      fixed_point coeff;
+
+      load_avg = fix_add (fix_mul (fix_frac (59, 60), load_avg),
+                          fix_frac (ready, 60));
+      twice_load = fix_scale (load_avg, 2);
+      coeff = fix_div (twice_load, fix_add (twice_load, FIX_ONE));
+      decay = fix_mul (coeff, decay);
+      carry = fix_add (fix_mul (coeff, carry), FIX_ONE);
+      mlfqs_coeffs[mlfqs_second++ % MLFQS_HISTORY] = coeff;
+      mlfqs_visit_bucket ();
+
+      /* Once the load average has been 0 for long enough that
+         every bucket has been visited with nothing but factors of
+         0, every further second gives the same result, so whole
+         rounds of buckets can be skipped. */
+      if (coeff != 0)
+        zero_seconds = 0;
+      else if (++zero_seconds >= 2 * MLFQS_HISTORY) 
+        {
+          mlfqs_second += seconds - seconds % MLFQS_HISTORY;
+          seconds %= MLFQS_HISTORY;
+        }
+    }
+
+  for (e = list_begin (runnable); e != list_end (runnable);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, set_elem);
+      if (is_idle (t))
+        continue;
+      mlfqs_decay (t, decay, carry);
+      set_priority (t, mlfqs_priority (t));
+    }
+
+  while (!list_empty (&cpu_dirty_list)) 
+    list_entry (list_pop_front (&cpu_dirty_list), struct thread,
+                cpu_dirty_elem)->cpu_dirty = false;
+}
+
+/* Returns the MLFQS priority for T, given its recent_cpu and nice
+   values. */
+static int
+mlfqs_priority (const struct thread *t) 
+{
+  int priority = PRI_MAX - fix_trunc (fix_unscale (t->recent_cpu, 4))
+                 - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  else if (priority > PRI_MAX)
+    return PRI_MAX;
+  else
+    return priority;
+}
+
+/* Applies to T's recent_cpu the updates whose factors multiply
+   to DECAY and add up to CARRY, as described at
+   mlfqs_seconds(). */
+static void
+mlfqs_decay (struct thread *t, fixed_point decay, fixed_point carry) 
+{
+  t->recent_cpu = fix_add (fix_mul (decay, t->recent_cpu),
+                           fix_scale (carry, t->nice));
+}
+
+/* Brings up to date the blocked threads in the bucket whose
+   threads were last brought up to date MLFQS_HISTORY seconds
+   ago, which is the one for the current second, and recomputes
+   their priorities. */
+static void
+mlfqs_visit_bucket (void) 
+{
+  struct list *bucket = &mlfqs_blocked[mlfqs_second % MLFQS_HISTORY];
+  fixed_point decay = FIX_ONE;
+  fixed_point carry = 0;
+  struct list_elem *e;
+  int i;
+
+  if (mlfqs_second < MLFQS_HISTORY || list_empty (bucket))
+    return;
+
+  for (i = 0; i < MLFQS_HISTORY; i++) 
+    {
+      fixed_point coeff = mlfqs_coeffs[(mlfqs_second + i) % MLFQS_HISTORY];
+      decay = fix_mul (coeff, decay);
+      carry = fix_add (fix_mul (coeff, carry), FIX_ONE);
+    }
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e)) 
+    {
+      struct thread *t = list_entry (e, struct thread, mlfqs_elem);
+      mlfqs_decay (t, decay, carry);
+      set_priority (t, mlfqs_priority (t));
+      t->mlfqs_stamp = mlfqs_second;
+    }
+}
+
+/* Files T, which is blocking, in the bucket for the current
+   second.  Its priority is recomputed then, or when it wakes up,
+   so it no longer needs to be on cpu_dirty_list. */
+static void
+mlfqs_block (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->cpu_dirty) 
+    {
+      list_remove (&t->cpu_dirty_elem);
+      t->cpu_dirty = false;
+    }
+  t->mlfqs_stamp = mlfqs_second;
+  list_push_back (&mlfqs_blocked[mlfqs_second % MLFQS_HISTORY],
+                  &t->mlfqs_elem);
+}
+
+/* Takes T, which is waking up, out of its bucket, if it is in
+   one, and applies the updates since its bucket was last
+   visited. */
+static void
+mlfqs_unblock (struct thread *t) 
+{
+  int64_t second;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->mlfqs_stamp < 0)
+    return;
+  list_remove (&t->mlfqs_elem);
+
+  /* If whole rounds of buckets were skipped, the factors were all
+     0 and only the last MLFQS_HISTORY of them matter. */
+  second = t->mlfqs_stamp;
+  if (second < mlfqs_second - MLFQS_HISTORY)
+    second = mlfqs_second - MLFQS_HISTORY;
+  for (; second < mlfqs_second; second++)
+    mlfqs_decay (t, mlfqs_coeffs[second % MLFQS_HISTORY], FIX_ONE);
+  set_priority (t, mlfqs_priority (t));
+  t->mlfqs_stamp = -1;
+}
+
+/* Returns T's CFS weight, according to its nice value. */
+static int
+cfs_weight (const struct thread *t) 
+{
+  return cfs_weights[t->nice - NICE_MIN];
+}
+
+/* Charges the thread running on C, which must be the running
+   CPU, for the time since it was last charged, and advances C's
+   min_vruntime, the least vruntime of any thread there, which
+   never goes backward. */
+static void
+cfs_update (struct cpu *c) 
+{
+  struct thread *cur = c->running;
+  struct thread *first = ready_peek (c);
+  int64_t now = timer_now_ns ();
+  int64_t delta = now - c->exec_start;
+  int64_t min;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (c == cpu_current ());
+
+  c->exec_start = now;
+  if (!is_idle (cur)) 
+    {
+      if (delta > 0) 
+        {
+          cur->slice_ns += delta;
+          cur->vruntime += delta * CFS_NICE_0_WEIGHT / cfs_weight (cur);
+        }
+      min = cur->vruntime;
+      if (first != NULL && first->vruntime < min)
+        min = first->vruntime;
+    }
+  else if (first != NULL)
+    min = first->vruntime;
   else
-    kernel_ticks++;
+    return;
+  if (min > c->min_vruntime)
+    c->min_vruntime = min;
+}
+
+/* Returns the length of T's slice of C's scheduling period, in
+   nanoseconds, in proportion to T's share of the total weight of
+   C's running and ready threads. */
+static int64_t
+cfs_slice (const struct cpu *c, const struct thread *t) 
+{
+  int64_t period = CFS_LATENCY_NS;
+  int64_t weight = cfs_weight (t);
+  int nr = c->ready_cnt + 1;
+
+  if (nr > CFS_LATENCY_NS / CFS_MIN_GRANULARITY_NS)
+    period = (int64_t) nr * CFS_MIN_GRANULARITY_NS;
+  return period * weight / (c->cfs_weight + weight);
+}
+
+/* Does the CFS bookkeeping for a timer tick on C, during which T
+   was running.  T yields once it has used up its slice, or once
+   it has run for at least the minimum granularity and gotten
+   more than a slice of virtual time ahead of the next thread. */
+static void
+cfs_tick (struct cpu *c, struct thread *t) 
+{
+  struct thread *first;
+  int64_t slice;
+
+  cfs_update (c);
+  first = ready_peek (c);
+  if (is_idle (t) || first == NULL)
+    return;
+
+  slice = cfs_slice (c, t);
+  if (t->slice_ns >= slice
+      || (t->slice_ns >= CFS_MIN_GRANULARITY_NS
+          && t->vruntime - first->vruntime > slice))
+    intr_yield_on_return ();
+}
+
+/* Does the stride scheduler's bookkeeping for a timer tick on C,
+   during which T was running: advances C's global pass and T's
+   pass, and yields if that leaves another thread ready with a
+   lesser pass. */
+static void
+stride_tick (struct cpu *c, struct thread *t) 
+{
+  int64_t tickets = c->stride_tickets;
+
+  if (!is_idle (t)) 
+    {
+      tickets += t->tickets;
+      t->pass += STRIDE1 / t->tickets;
+    }
+  if (tickets > 0)
+    c->global_pass += STRIDE1 / tickets;
+
+  if (should_preempt (c, ready_peek (c)))
+    intr_yield_on_return ();
+}
+
+/* Does the EDF bookkeeping for a timer tick on C, during which T
+   was running: charges T's budget if T is an EDF thread,
+   throttling T if the budget is used up, and starts a new job for
+   each throttled thread whose next period has begun. */
+static void
+dl_tick (struct cpu *c, struct thread *t) 
+{
+  int64_t now = timer_ticks ();
+  struct list_elem *e;
+
+  if (t->dl_period != 0 && --t->dl_budget <= 0) 
+    {
+      t->dl_throttled = true;
+      intr_yield_on_return ();
+    }
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  for (e = list_begin (&c->dl_throttled); e != list_end (&c->dl_throttled);)
+    {
+      struct thread *r = list_entry (e, struct thread, elem);
+
+      e = list_next (e);
+      if (r->dl_release + r->dl_period <= now) 
+        {
+          ready_remove (r);
+          r->dl_throttled = false;
+          r->dl_jobs++;
+          r->dl_misses++;
+          dl_new_job (r, r->dl_release + r->dl_period);
+          ready_push (r);
+        }
+    }
+
+  if (should_preempt (c, ready_peek (c)))
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Starts a new job for EDF thread T, released at tick RELEASE. */
+static void
+dl_new_job (struct thread *t, int64_t release) 
+{
+  t->dl_release = release;
+  t->dl_abs_deadline = release + t->dl_deadline;
+  t->dl_budget = t->dl_runtime;
+}
+
+/* Returns true if EDF thread A's job has an earlier deadline than
+   EDF thread B's. */
+static bool
+dl_less (const struct list_elem *a_, const struct list_elem *b_,
+         void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->dl_abs_deadline < b->dl_abs_deadline;
+}
+
+/* Returns true if thread A's pass is less than thread B's. */
+static bool
+stride_less (const struct rb_elem *a_, const struct rb_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct thread *a = rb_entry (a_, struct thread, fair_elem);
+  const struct thread *b = rb_entry (b_, struct thread, fair_elem);
+
+  return a->pass < b->pass;
+}
+
+/* Returns true if thread A has less virtual run time than thread
+   B. */
+static bool
+cfs_less (const struct rb_elem *a_, const struct rb_elem *b_,
+          void *aux UNUSED) 
+{
+  const struct thread *a = rb_entry (a_, struct thread, fair_elem);
+  const struct thread *b = rb_entry (b_, struct thread, fair_elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Prints thread statistics, including the wakeup latencies of
+   all threads and, for each thread still alive, its own. */
 void
 thread_print_stats (void) 
 {
+  enum intr_level old_level;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld context switches\n", context_switches);
+  if (thread_handoff)
+    printf ("Thread: %lld handoffs\n", handoffs);
+  printf ("Thread: %lld thread pages reused\n", page_cache_hits);
+  if (cpu_cnt > 1) 
+    {
+      unsigned i;
+
+      for (i = 0; i < cpu_cnt; i++)
+        printf ("Thread: CPU %u: %"PRId64" idle ticks, "
+                "%"PRId64" threads migrated in\n",
+                i, cpus[i].idle_ticks, cpus[i].migrations);
+    }
+  latency_print ("all threads", &wakeup_latency);
+
+  old_level = intr_disable ();
+  thread_foreach (print_thread_stats, NULL);
+  intr_set_level (old_level);
+}
+
+/* Prints thread T's run time, switch counts, wakeup latencies,
+   and use of resources.  Run time includes the current run of a
+   running thread. */
+static void
+print_thread_stats (struct thread *t, void *aux UNUSED) 
+{
+  int64_t run_ns = t->run_ns;
+
+  if (t->status == THREAD_RUNNING)
+    run_ns += timer_now_ns () - t->run_start_ns;
+  printf ("Thread: %s: %"PRId64" us run, %"PRIu32" voluntary and "
+          "%"PRIu32" involuntary switches\n", t->name, run_ns / 1000,
+          t->voluntary_switches, t->involuntary_switches);
+  printf ("Thread: %s: %"PRId64" user and %"PRId64" kernel ticks, "
+          "%"PRId64" us waiting for locks, %"PRId64" us asleep\n",
+          t->name, t->user_ticks, t->kernel_ticks,
+          t->lock_wait_ns / 1000, t->sleep_ns / 1000);
+  printf ("Thread: %s: %"PRIu32" sectors read, %"PRIu32" written, "
+          "%"PRIu32" pages allocated\n", t->name, t->sectors_read,
+          t->sectors_written, t->pages_allocated);
+  latency_print (t->name, &t->wakeup_latency);
+}
+
+/* Adds a wakeup latency of NS nanoseconds to H. */
+static void
+latency_record (struct latency_hist *h, int64_t ns) 
+{
+  int64_t us = ns / 1000;
+  int bucket;
+
+  h->cnt++;
+  h->total_ns += ns;
+  if (ns > h->max_ns)
+    h->max_ns = ns;
+
+  for (bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++)
+    if ((us >> (bucket + 1)) == 0)
+      break;
+  h->hist[bucket]++;
+}
+
+/* Prints the wakeup latencies in H, for NAME, followed by the
+   nonempty buckets of its histogram, each labeled with its lower
+   bound in microseconds as a power of 2. */
+static void
+latency_print (const char *name, const struct latency_hist *h) 
+{
+  int bucket;
+
+  if (h->cnt == 0)
+    return;
+  printf ("Thread: %s: %"PRIu32" wakeups, latency avg %"PRId64
+          " us, max %"PRId64" us\n", name, h->cnt,
+          h->total_ns / h->cnt / 1000, h->max_ns / 1000);
+  printf ("Thread: %s:", name);
+  for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    if (h->hist[bucket] != 0)
+      printf (" 2^%d:%"PRIu32, bucket, h->hist[bucket]);
+  printf ("\n");
+}
+
+/* Returns the number of times the CPU has switched from one
+   thread to another since boot. */
+long long
+thread_context_switches (void) 
+{
+  return context_switches;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -159,9 +1010,9 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   The new thread runs ahead of every thread with a lower
+   PRIORITY, including the running thread, which yields to it at
+   once if it has a higher priority. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -176,13 +1027,31 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
-  tid = t->tid = allocate_tid ();
+  tid = allocate_tid (t);
+  t->timer_slack = thread_current ()->timer_slack;
+
+  /* Under the MLFQS, the new thread starts out with its creator's
+     nice and recent_cpu, and PRIORITY is ignored.  Under the CFS,
+     it inherits its creator's nice. */
+  if (thread_mlfqs) 
+    {
+      t->nice = thread_current ()->nice;
+      t->recent_cpu = thread_current ()->recent_cpu;
+      t->priority = t->base_priority = mlfqs_priority (t);
+    }
+  else if (thread_cfs)
+    t->nice = thread_current ()->nice;
+
+  /* The new thread gets as many tickets as its creator has of its
+     own, and first runs one stride after the global pass. */
+  t->base_tickets = t->tickets = thread_current ()->base_tickets;
+  t->pass_remain = STRIDE1 / t->tickets;
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -204,6 +1073,8 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
+  t->cpu = least_loaded_cpu ();
+  t->vruntime = t->cpu->min_vruntime;
   intr_set_level (old_level);
 
   /* Add to run queue. */
@@ -221,35 +1092,139 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  block (THREADS_BLOCKED);
+}
+
+/* Like thread_block(), but for a thread that is sleeping until
+   a given time, which is therefore counted in the sleeping set
+   rather than the blocked set.  For the timer's use. */
+void
+thread_sleep (void) 
+{
+  block (THREADS_SLEEPING);
+}
+
+/* Blocks the current thread, which moves to SET. */
+static void
+block (enum thread_set set) 
+{
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  cur->status = THREAD_BLOCKED;
+  if (set == THREADS_SLEEPING)
+    cur->sleep_start_ns = timer_now_ns ();
+  if (!is_idle (cur)) 
+    {
+      move_thread (cur, set);
+      if (thread_mlfqs)
+        mlfqs_block (cur);
+    }
   schedule ();
 }
 
-/* Transitions a blocked thread T to the ready-to-run state.
-   This is an error if T is not blocked.  (Use thread_yield() to
-   make the running thread ready.)
-
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+/* Transitions a blocked thread T to the ready-to-run state, on
+   the CPU it last ran on.  This is an error if T is not blocked.
+   (Use thread_yield() to make the running thread ready.)
+
+   If T has a higher priority than the running thread, the
+   running thread yields to it, but only if interrupts were on
+   when this function was called.  This can be important: if the
+   caller had disabled interrupts itself, it may expect that it
+   can atomically unblock a thread and update other data.  Such a
+   caller should call thread_preempt() once it turns interrupts
+   back on.  In an interrupt handler, the yield happens when the
+   handler returns.  If T goes to another CPU, that CPU is
+   interrupted to reschedule instead, if it is idle or T has a
+   higher priority than the thread it is running. */
 void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+  int64_t now = timer_now_ns ();
+  bool local;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  if (t->set == THREADS_SLEEPING)
+    t->sleep_ns += now - t->sleep_start_ns;
+  if (thread_cfs) 
+    {
+      int64_t floor = t->cpu->min_vruntime - CFS_LATENCY_NS / 2;
+      if (t->vruntime < floor)
+        t->vruntime = floor;
+    }
+  else if (thread_stride)
+    t->pass = t->cpu->global_pass + t->pass_remain;
+  else if (thread_mlfqs)
+    mlfqs_unblock (t);
+  move_thread (t, THREADS_RUNNABLE);
+  ready_push (t);
   t->status = THREAD_READY;
+  t->wakeup_ns = now;
+  local = t->cpu == cpu_current ();
+  if (!local && should_preempt (t->cpu, t))
+    smp_reschedule (t->cpu);
   intr_set_level (old_level);
+
+  if (local && (old_level == INTR_ON || intr_context ()))
+    thread_preempt ();
+}
+
+
+/* Notes that the running thread has just woken T, so that if it
+   blocks before it next gives up the CPU, T runs in its place
+   for the rest of its time slice.  Does nothing unless handoffs
+   are enabled with "-handoff".  Interrupts must be off. */
+void
+thread_hand_off (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (is_thread (t));
+
+  if (thread_handoff && !intr_context ())
+    thread_current ()->handoff_tid = t->tid;
+}
+
+/* Returns the thread whose tid is TID, or a null pointer if
+   there is no such thread or it has exited.  Interrupts must be
+   off, and the thread is only guaranteed to go on existing while
+   they stay off. */
+struct thread *
+thread_lookup (tid_t tid) 
+{
+  struct list *bucket = &tid_buckets[(unsigned) tid % TID_BUCKETS];
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e)) 
+    {
+      struct thread *t = list_entry (e, struct thread, tid_elem);
+      if (t->tid == tid)
+        return t;
+    }
+  return NULL;
 }
 
+/* Moves T, which must be in a set, to SET.  Interrupts must be
+   off. */
+static void
+move_thread (struct thread *t, enum thread_set set) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (set < THREADS_SET_CNT);
+
+  if (t->set == set)
+    return;
+  list_remove (&t->set_elem);
+  list_push_back (&thread_sets[set], &t->set_elem);
+  t->set = set;
+}
 
 /* Returns the name of the running thread. */
 const char *
@@ -258,6 +1233,15 @@ thread_name (void)
   return thread_current ()->name;
 }
 
+/* Returns the CPU that the caller is running on.  Only
+   meaningful with interrupts off, or in a thread that cannot move
+   to another CPU. */
+struct cpu *
+cpu_current (void) 
+{
+  return running_thread ()->cpu;
+}
+
 /* Returns the running thread.
    This is running_thread() plus a couple of sanity checks.
    See the big comment at the top of thread.h for details. */
@@ -294,12 +1278,21 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  fpu_exit ();
 
-  /* Remove thread from all threads list, set our status to dying,
-     and schedule another process.  That process will destroy us
-     when it calls thread_schedule_tail(). */
+  if (thread_current ()->dl_period != 0)
+    printf ("%s: missed %d of %d deadlines\n", thread_name (),
+            thread_current ()->dl_misses, thread_current ()->dl_jobs);
+
+  /* Move thread to the dying set, set our status to dying, and
+     schedule another process.  That process will destroy us when
+     it calls thread_schedule_tail(). */
   intr_disable ();
-  list_remove (&thread_current()->allelem);
+  move_thread (thread_current (), THREADS_DYING);
+  list_remove (&thread_current ()->tid_elem);
+  thread_current ()->cpu->dl_bw -= thread_current ()->dl_bw;
+  if (thread_current ()->cpu_dirty)
+    list_remove (&thread_current ()->cpu_dirty_elem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -316,35 +1309,163 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+  if (!is_idle (cur)) 
+    ready_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
-/* Invoke function 'func' on all threads, passing along 'aux'.
-   This function must be called with interrupts off. */
+/* Yields the CPU if a ready thread has a higher priority than the
+   running thread.  In an interrupt handler, arranges to yield
+   when the handler returns instead. */
 void
-thread_foreach (thread_action_func *func, void *aux)
+thread_preempt (void) 
 {
-  struct list_elem *e;
+  enum intr_level old_level = intr_disable ();
+  bool yield = ready_preempts (cpu_current ());
+  intr_set_level (old_level);
+
+  if (yield) 
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
+}
+
+/* Invoke function 'func' on all threads that have not exited,
+   passing along 'aux'.  This function must be called with
+   interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux)
+{
+  int set;
+
+  for (set = 0; set < THREADS_SET_CNT; set++)
+    if (set != THREADS_DYING)
+      thread_foreach_in (set, func, aux);
+}
+
+/* Invokes FUNC on each thread in SET, passing along AUX.  FUNC
+   must not move threads between sets.  Must be called with
+   interrupts off. */
+void
+thread_foreach_in (enum thread_set set, thread_action_func *func, void *aux)
+{
+  struct list_elem *e;
 
   ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (set < THREADS_SET_CNT);
 
-  for (e = list_begin (&all_list); e != list_end (&all_list);
+  for (e = list_begin (&thread_sets[set]); e != list_end (&thread_sets[set]);
        e = list_next (e))
     {
-      struct thread *t = list_entry (e, struct thread, allelem);
+      struct thread *t = list_entry (e, struct thread, set_elem);
       func (t, aux);
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's timer slack to SLACK ticks: its
+   timer_sleep() calls may return up to SLACK ticks late, which
+   lets the timer wake it together with other sleeping threads.
+   Threads inherit the timer slack of the thread that created
+   them. */
+void
+thread_set_timer_slack (int64_t slack) 
+{
+  ASSERT (slack >= 0);
+  thread_current ()->timer_slack = slack;
+}
+
+/* Returns the current thread's timer slack, in ticks. */
+int64_t
+thread_get_timer_slack (void) 
+{
+  return thread_current ()->timer_slack;
+}
+
+/* Sets the current thread's base priority to NEW_PRIORITY, and
+   yields if a ready thread now has a higher priority.  Priorities
+   donated to the thread still apply until it releases the locks
+   they were donated through.  Does nothing under the MLFQS,
+   which sets priorities itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  thread_current ()->base_priority = new_priority;
+  thread_update_priority (thread_current ());
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Raises T's priority to PRIORITY, which a thread waiting for a
+   lock that T holds is donating to it, unless T's priority is
+   already at least that high.  Does not preempt the running
+   thread.  Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t, int priority) 
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority > t->priority)
+    set_priority (t, priority);
+}
+
+/* Recomputes T's priority as the higher of its base priority and
+   the priority of the highest-priority thread waiting for any of
+   the locks it holds.  Does not preempt the running thread.
+   Interrupts must be off. */
+void
+thread_update_priority (struct thread *t) 
+{
+  struct list_elem *e;
+  int priority;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  priority = t->base_priority;
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
+    {
+      struct list *waiters = &list_entry (e, struct lock, elem)
+                              ->semaphore.waiters;
+      if (!list_empty (waiters)) 
+        {
+          struct thread *w = list_entry (list_max (waiters,
+                                                   thread_priority_less,
+                                                   NULL),
+                                         struct thread, elem);
+          if (w->priority > priority)
+            priority = w->priority;
+        }
+    }
+  set_priority (t, priority);
+}
+
+/* Returns true if the thread whose `elem' is A_ has a lower
+   priority than the one whose `elem' is B_.  Suitable for
+   list_max(), to find the highest-priority thread in a list,
+   earliest among equals. */
+bool
+thread_priority_less (const struct list_elem *a_, const struct list_elem *b_,
+                      void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority < b->priority;
 }
 
 /* Returns the current thread's priority. */
@@ -354,59 +1475,270 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority, and yields if a ready thread now has a higher
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  if (thread_cfs)
+    cfs_update (cur->cpu);
+  cur->nice = nice;
+  if (thread_mlfqs)
+    set_priority (cur, mlfqs_priority (cur));
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Puts the current thread in the EDF class, to run for RUNTIME
+   ticks in every PERIOD ticks, finishing each period's job within
+   DEADLINE ticks of the period's start, which must satisfy 0 <
+   RUNTIME <= DEADLINE <= PERIOD.  The first period starts now.
+   Returns true if successful, false if its CPU cannot take on
+   that much EDF work, in which case nothing changes.
+
+   If PERIOD is 0, takes the current thread out of the EDF class
+   instead, and RUNTIME and DEADLINE are ignored. */
+bool
+thread_set_deadline (int64_t period, int64_t runtime, int64_t deadline) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  struct cpu *c;
+  enum intr_level old_level;
+  int64_t bw = 0;
+
+  ASSERT (period == 0 || (0 < runtime && runtime <= deadline
+                          && deadline <= period));
+
+  old_level = intr_disable ();
+  c = cur->cpu;
+  if (period != 0) 
+    {
+      bw = DIV_ROUND_UP (runtime * DL_BW_ONE, deadline);
+      if (c->dl_bw - cur->dl_bw + bw > DL_BW_MAX) 
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+    }
+  else if (cur->dl_period != 0)
+    {
+      /* Rejoin the other threads without a head start or a
+         debt. */
+      if (thread_cfs)
+        cfs_update (c);
+      cur->vruntime = c->min_vruntime;
+      cur->pass = c->global_pass;
+    }
+  c->dl_bw += bw - cur->dl_bw;
+  cur->dl_bw = bw;
+  cur->dl_period = period;
+  cur->dl_runtime = runtime;
+  cur->dl_deadline = deadline;
+  if (period != 0)
+    dl_new_job (cur, timer_ticks ());
+  intr_set_level (old_level);
+
+  thread_preempt ();
+  return true;
+}
+
+/* Finishes the current EDF thread's job for this period and
+   sleeps until the next period begins.  If the period is already
+   over, the next job starts at once. */
+void
+thread_wait_period (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now, release;
+
+  ASSERT (cur->dl_period != 0);
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  cur->dl_jobs++;
+  if (now > cur->dl_abs_deadline)
+    cur->dl_misses++;
+  release = cur->dl_release + cur->dl_period;
+  dl_new_job (cur, release > now ? release : now);
+  intr_set_level (old_level);
+
+  if (release > now)
+    timer_sleep (release - now);
+}
+
+/* Returns the number of the current thread's EDF jobs that
+   missed their deadlines. */
+int
+thread_get_deadline_misses (void) 
+{
+  return thread_current ()->dl_misses;
+}
+
+/* Returns the current thread's number of tickets, including any
+   transferred to it. */
+int
+thread_get_tickets (void) 
+{
+  return thread_current ()->tickets;
+}
+
+/* Sets the current thread's number of tickets to TICKETS, not
+   counting any transferred to it.  Tickets only matter to the
+   stride scheduler. */
+void
+thread_set_tickets (int tickets) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+  old_level = intr_disable ();
+  cur->base_tickets = tickets;
+  thread_update_tickets (cur);
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Adds TICKETS, which may be negative to take them back, to the
+   tickets of thread T.  A thread that is about to block waiting
+   for T can lend T its tickets this way, so that T gets the CPU
+   share of both until it is done.  Does not preempt the running
+   thread.  Interrupts must be off. */
+void
+thread_transfer_tickets (struct thread *t, int tickets) 
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->tickets + tickets >= TICKETS_MIN);
+
+  set_tickets (t, t->tickets + tickets);
+}
+
+/* Recomputes T's tickets as its own plus those of every thread
+   waiting for any of the locks it holds.  Does not preempt the
+   running thread.  Interrupts must be off. */
+void
+thread_update_tickets (struct thread *t) 
+{
+  struct list_elem *e, *w;
+  int tickets;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  tickets = t->base_tickets;
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
+    {
+      struct list *waiters = &list_entry (e, struct lock, elem)
+                              ->semaphore.waiters;
+      for (w = list_begin (waiters); w != list_end (waiters);
+           w = list_next (w))
+        tickets += list_entry (w, struct thread, elem)->tickets;
+    }
+  set_tickets (t, tickets);
+}
+
+/* Sets T's tickets to TICKETS, moving it within its run queue if
+   it is ready. */
+static void
+set_tickets (struct thread *t, int tickets) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status == THREAD_READY) 
+    {
+      ready_remove (t);
+      t->tickets = tickets;
+      ready_push (t);
+    }
+  else
+    t->tickets = tickets;
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level;
+  int load;
+
+  old_level = intr_disable ();
+  load = fix_round (fix_scale (load_avg, 100));
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level;
+  int cpu;
+
+  old_level = intr_disable ();
+  cpu = fix_round (fix_scale (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+  return cpu;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   point it initializes the boot CPU's idle_thread, "up"s the
+   semaphore passed to it to enable thread_start() to continue,
+   and immediately blocks.  After that, the idle thread never
+   appears in the ready list.  It is returned by
+   next_thread_to_run() as a special case when the ready list is
+   empty.  Each application processor has an idle thread too,
+   created by thread_prepare_ap(), which runs from the start. */
 static void
 idle (void *idle_started_ UNUSED) 
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
+  cpus[0].idle_thread = thread_current ();
   sema_up (idle_started);
 
+  idle_loop ();
+}
+
+/* Body of the idle threads. */
+static void
+idle_loop (void) 
+{
+  bool boot_cpu = cpu_current () == &cpus[0];
+
   for (;;) 
     {
-      /* Let someone else run. */
+      /* Let someone else run.  schedule() restarts the periodic
+         tick if timer_idle_enter() stopped it. */
       intr_disable ();
       thread_block ();
 
+      /* In tickless mode, stop the periodic timer interrupt until
+         the next tick on which something is due.  Only the boot
+         CPU's timer drives the tick count.  Throttled EDF threads
+         need the tick to start their next jobs. */
+      if (boot_cpu && list_empty (&cpus[0].dl_throttled))
+        timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -418,8 +1750,9 @@ idle (void *idle_started_ UNUSED)
          time.
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
-      asm volatile ("sti; hlt" : : : "memory");
+         7.11.1 "HLT Instruction".  intr_wait() does the same, after
+         letting the other CPUs run with interrupts off. */
+      intr_wait ();
     }
 }
 
@@ -460,6 +1793,8 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -468,9 +1803,18 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->held_locks);
+  t->nice = NICE_DEFAULT;
+  t->recent_cpu = 0;
+  t->base_tickets = t->tickets = TICKETS_DEFAULT;
+  t->mlfqs_stamp = -1;
   t->magic = THREAD_MAGIC;
-  list_push_back (&all_list, &t->allelem);
+
+  old_level = intr_disable ();
+  t->set = THREADS_BLOCKED;
+  list_push_back (&thread_sets[THREADS_BLOCKED], &t->set_elem);
+  intr_set_level (old_level);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -486,18 +1830,383 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+/* Returns a page for a new thread, from the cache of dead
+   threads' pages if possible, or a null pointer if none is
+   available.  Only the start of the page, which init_thread()
+   initializes, is guaranteed to be zeroed. */
 static struct thread *
-next_thread_to_run (void) 
+alloc_thread_page (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *t = NULL;
+
+  if (page_cache_cnt > 0) 
+    {
+      t = page_cache[--page_cache_cnt];
+      page_cache_hits++;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Puts dead thread T's page in the cache, or frees it if the
+   cache is full.  Interrupts must be off. */
+static void
+free_thread_page (struct thread *t) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (page_cache_cnt < PAGE_CACHE_SIZE)
+    page_cache[page_cache_cnt++] = t;
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    palloc_free_page (t);
+}
+
+/* Adds T to the back of the run queue for its priority on its
+   CPU, or, if T is an EDF thread, to its CPU's EDF queue. */
+static void
+ready_push (struct thread *t) 
+{
+  struct cpu *c = t->cpu;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->dl_period != 0) 
+    {
+      if (t->dl_throttled)
+        list_push_back (&c->dl_throttled, &t->elem);
+      else 
+        {
+          list_insert_ordered (&c->dl_ready, &t->elem, dl_less, NULL);
+          c->dl_cnt++;
+        }
+      return;
+    }
+  if (thread_cfs) 
+    {
+      /* A thread going back in the queue has to be charged for
+         its run first. */
+      if (t == c->running)
+        cfs_update (c);
+      rb_insert (&c->fair_tree, &t->fair_elem);
+      c->cfs_weight += cfs_weight (t);
+    }
+  else if (thread_stride) 
+    {
+      rb_insert (&c->fair_tree, &t->fair_elem);
+      c->stride_tickets += t->tickets;
+    }
+  else 
+    {
+      list_push_back (&c->ready_lists[t->priority], &t->elem);
+      c->ready_mask |= (uint64_t) 1 << t->priority;
+    }
+  c->ready_cnt++;
+}
+
+/* Removes ready thread T from its run queue. */
+static void
+ready_remove (struct thread *t) 
+{
+  struct cpu *c = t->cpu;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  if (t->dl_period != 0) 
+    {
+      list_remove (&t->elem);
+      if (!t->dl_throttled)
+        c->dl_cnt--;
+      return;
+    }
+  if (thread_cfs) 
+    {
+      rb_remove (&c->fair_tree, &t->fair_elem);
+      c->cfs_weight -= cfs_weight (t);
+    }
+  else if (thread_stride) 
+    {
+      rb_remove (&c->fair_tree, &t->fair_elem);
+      c->stride_tickets -= t->tickets;
+    }
+  else 
+    {
+      list_remove (&t->elem);
+      if (list_empty (&c->ready_lists[t->priority]))
+        c->ready_mask &= ~((uint64_t) 1 << t->priority);
+    }
+  c->ready_cnt--;
+}
+
+/* Returns true if T is one of the idle threads. */
+static bool
+is_idle (const struct thread *t) 
+{
+  return t == t->cpu->idle_thread;
+}
+
+/* Returns true if ready thread T, which may be a null pointer,
+   should preempt the thread running on C.  Anything preempts an
+   idle thread.  An EDF thread preempts any but an EDF thread
+   with an earlier or equal deadline, and nothing else preempts an
+   EDF thread.  Otherwise, T must have a higher priority or, under
+   the CFS, have run for less virtual time by a margin. */
+static bool
+should_preempt (const struct cpu *c, const struct thread *t) 
+{
+  if (t == NULL)
+    return false;
+  if (is_idle (c->running))
+    return true;
+  if (c->running->dl_period != 0)
+    return (t->dl_period != 0
+            && t->dl_abs_deadline < c->running->dl_abs_deadline);
+  if (t->dl_period != 0)
+    return true;
+  if (thread_cfs)
+    return t->vruntime + CFS_WAKEUP_GRANULARITY_NS < c->running->vruntime;
+  if (thread_stride)
+    return t->pass < c->running->pass;
+  return t->priority > c->running->priority;
+}
+
+/* Returns true if the run queues are red-black trees. */
+static bool
+fair_sched (void) 
+{
+  return thread_cfs || thread_stride;
+}
+
+/* Returns true if the thread that would run next on C should
+   preempt the one running there.  C must be the running CPU. */
+static bool
+ready_preempts (struct cpu *c) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_cfs)
+    cfs_update (c);
+  return should_preempt (c, ready_peek (c));
+}
+
+/* Returns the number of threads ready or running on C. */
+static int
+cpu_load (const struct cpu *c) 
+{
+  return c->ready_cnt + c->dl_cnt + !is_idle (c->running);
+}
+
+/* Returns the started CPU with the fewest threads ready or
+   running, preferring the current CPU on a tie. */
+static struct cpu *
+least_loaded_cpu (void) 
+{
+  struct cpu *best = cpu_current ();
+  int best_load = cpu_load (best);
+  unsigned i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (i = 0; i < cpu_cnt; i++) 
+    {
+      struct cpu *c = &cpus[i];
+      int load = cpu_load (c);
+      if (c->started && load < best_load) 
+        {
+          best = c;
+          best_load = load;
+        }
+    }
+  return best;
+}
+
+/* Sets T's priority to PRIORITY, moving it to the matching run
+   queue if it is ready. */
+static void
+set_priority (struct thread *t, int priority) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY) 
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
+}
+
+/* Moves ready threads from the busiest other CPU to C.  If IDLE
+   is true, C has no ready threads of its own, and takes half of
+   the busiest CPU's ready threads, rounded up.  Otherwise, it
+   takes enough to bring the two CPUs' loads within one thread of
+   each other.  The moved threads are the busiest CPU's
+   highest-priority ready threads, each the last in line at its
+   priority, so that the threads that would have run next there
+   still do.  Under the CFS, they are the ones that would run
+   last.  EDF threads never move.  Returns true if any threads
+   moved. */
+static bool
+balance (struct cpu *c, bool idle) 
+{
+  struct cpu *busiest = NULL;
+  int busiest_load = 0;
+  int cnt, i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (i = 0; i < (int) cpu_cnt; i++) 
+    {
+      struct cpu *b = &cpus[i];
+      int load = cpu_load (b);
+      if (b != c && b->started && b->ready_cnt > 0 && load > busiest_load) 
+        {
+          busiest = b;
+          busiest_load = load;
+        }
+    }
+  if (busiest == NULL)
+    return false;
+
+  if (idle)
+    cnt = (busiest->ready_cnt + 1) / 2;
+  else
+    cnt = (busiest_load - cpu_load (c)) / 2;
+  if (cnt > busiest->ready_cnt)
+    cnt = busiest->ready_cnt;
+
+  /* C may be the busier one, in which case there is nothing to
+     take. */
+  if (cnt <= 0)
+    return false;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      struct thread *t;
+
+      if (fair_sched ()) 
+        {
+          /* Take the thread that would run last, keeping its
+             distance from the CPU's virtual time. */
+          t = rb_entry (rb_max (&busiest->fair_tree),
+                        struct thread, fair_elem);
+          ready_remove (t);
+          t->vruntime += c->min_vruntime - busiest->min_vruntime;
+          t->pass += c->global_pass - busiest->global_pass;
+        }
+      else 
+        {
+          int priority = ready_max_priority (busiest);
+          struct list *list = &busiest->ready_lists[priority];
+          t = list_entry (list_back (list), struct thread, elem);
+          ready_remove (t);
+        }
+      t->cpu = c;
+      ready_push (t);
+      c->migrations++;
+    }
+  return true;
+}
+
+/* Returns the highest priority of any thread ready on C, or -1
+   if no thread is ready there. */
+static int
+ready_max_priority (const struct cpu *c) 
+{
+  uint32_t half;
+  int bit;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* BSR finds the most significant set bit of a nonzero word. */
+  half = c->ready_mask >> 32;
+  if (half != 0) 
+    {
+      asm ("bsrl %1, %0" : "=r" (bit) : "rm" (half));
+      return bit + 32;
+    }
+  half = c->ready_mask;
+  if (half != 0) 
+    {
+      asm ("bsrl %1, %0" : "=r" (bit) : "rm" (half));
+      return bit;
+    }
+  return -1;
+}
+
+/* Chooses and returns the next thread to be scheduled on this
+   CPU.  Should return the ready EDF thread with the earliest
+   deadline, if any, or else the first thread in the CPU's
+   highest-priority nonempty run queue, unless all its run queues
+   are empty.  (If the running thread can continue running, then
+   it will be in a run queue.)  If they are all empty, takes
+   threads from another CPU, and if there are none to take,
+   returns the CPU's idle thread. */
+static struct thread *
+next_thread_to_run (void) 
+{
+  struct cpu *c = cpu_current ();
+  int priority;
+  struct list *list;
+  struct thread *t;
+
+  if (!list_empty (&c->dl_ready)) 
+    {
+      t = list_entry (list_front (&c->dl_ready), struct thread, elem);
+      ready_remove (t);
+      return t;
+    }
+  if (c->ready_cnt == 0)
+    balance (c, true);
+  if (fair_sched ()) 
+    {
+      t = ready_peek (c);
+      if (t == NULL)
+        return c->idle_thread;
+      ready_remove (t);
+      return t;
+    }
+
+  priority = ready_max_priority (c);
+  if (priority < 0)
+    return c->idle_thread;
+
+  list = &c->ready_lists[priority];
+  t = list_entry (list_pop_front (list), struct thread, elem);
+  if (list_empty (list))
+    c->ready_mask &= ~((uint64_t) 1 << priority);
+  c->ready_cnt--;
+  return t;
+}
+
+/* Returns the thread that would run next on C, or a null pointer
+   if no thread is ready there. */
+static struct thread *
+ready_peek (struct cpu *c) 
+{
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&c->dl_ready))
+    return list_entry (list_front (&c->dl_ready), struct thread, elem);
+  if (fair_sched ())
+    return (rb_empty (&c->fair_tree) ? NULL
+            : rb_entry (rb_min (&c->fair_tree), struct thread, fair_elem));
+
+  priority = ready_max_priority (c);
+  if (priority < 0)
+    return NULL;
+  return list_entry (list_front (&c->ready_lists[priority]),
+                     struct thread, elem);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -520,14 +2229,36 @@ void
 thread_schedule_tail (struct thread *prev)
 {
   struct thread *cur = running_thread ();
+  struct cpu *c = cur->cpu;
+  int64_t now = timer_now_ns ();
   
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  c->running = cur;
+  if (thread_cfs) 
+    {
+      c->exec_start = now;
+      cur->slice_ns = 0;
+    }
 
-  /* Start new time slice. */
-  thread_ticks = 0;
+  /* Record how long we waited to run since we were unblocked. */
+  cur->run_start_ns = now;
+  if (cur->wakeup_ns != 0) 
+    {
+      latency_record (&cur->wakeup_latency, now - cur->wakeup_ns);
+      latency_record (&wakeup_latency, now - cur->wakeup_ns);
+      cur->wakeup_ns = 0;
+    }
+
+  /* Start new time slice, unless the thread we switched from
+     handed us the rest of its own. */
+  if (c->handoff)
+    c->handoff = false;
+  else
+    c->thread_ticks = 0;
+  intr_yield_complete ();
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -539,10 +2270,12 @@ thread_schedule_tail (struct thread *prev)
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
      palloc().) */
-  if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
+  if (prev != NULL && prev->status == THREAD_DYING) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      list_remove (&prev->set_elem);
+      if (prev != initial_thread)
+        free_thread_page (prev);
     }
 }
 
@@ -557,30 +2290,100 @@ static void
 schedule (void) 
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct thread *next;
   struct thread *prev = NULL;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
+
+  /* The boot CPU's idle thread may have stopped the periodic tick.
+     Restart it whenever that thread gives up the CPU, whether it
+     blocks at the top of idle_loop() or is preempted on return
+     from an interrupt that woke another thread. */
+  if (cur == cpus[0].idle_thread)
+    timer_idle_exit ();
+
+  /* Charge the outgoing thread for its run, even if it is not
+     going back in a run queue.  A blocking thread remembers its
+     place relative to the global pass. */
+  if (thread_cfs)
+    cfs_update (cur->cpu);
+  else if (thread_stride && cur->status == THREAD_BLOCKED)
+    cur->pass_remain = cur->pass - cur->cpu->global_pass;
+
+  next = NULL;
+  if (cur->handoff_tid != 0) 
+    {
+      if (cur->status == THREAD_BLOCKED)
+        next = handoff_target (cur);
+      cur->handoff_tid = 0;
+    }
+  if (next == NULL)
+    next = next_thread_to_run ();
   ASSERT (is_thread (next));
 
-  if (cur != next)
-    prev = switch_threads (cur, next);
+  cur->run_ns += timer_now_ns () - cur->run_start_ns;
+  if (cur != next) 
+    {
+      context_switches++;
+      if (cur->status == THREAD_READY)
+        cur->involuntary_switches++;
+      else
+        cur->voluntary_switches++;
+      if (cur->fpu_used)
+        fpu_save (cur);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Returns the thread that CUR, which is blocking, woke and
+   named in thread_hand_off(), taking it out of its run queue, or
+   a null pointer if that thread may not run next: if it is no
+   longer ready on CUR's CPU, if EDF threads are ready there, or,
+   under the priority schedulers, if a thread of higher priority
+   is ready.  The fair schedulers charge the thread for its run
+   as usual, so running it out of turn does not upset their
+   shares. */
+static struct thread *
+handoff_target (struct thread *cur) 
+{
+  struct cpu *c = cur->cpu;
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = thread_lookup (cur->handoff_tid);
+  if (t == NULL || t->status != THREAD_READY || t->cpu != c
+      || t->dl_period != 0 || c->dl_cnt != 0)
+    return NULL;
+  if (!fair_sched () && t->priority < ready_max_priority (c))
+    return NULL;
+
+  ready_remove (t);
+  c->handoff = true;
+  handoffs++;
+  return t;
+}
+
+/* Gives T a tid, which it returns, and enters T in the table
+   that thread_lookup() searches. */
 static tid_t
-allocate_tid (void) 
+allocate_tid (struct thread *t) 
 {
   static tid_t next_tid = 1;
-  tid_t tid;
+  enum intr_level old_level;
 
   lock_acquire (&tid_lock);
-  tid = next_tid++;
+  t->tid = next_tid++;
   lock_release (&tid_lock);
 
-  return tid;
+  old_level = intr_disable ();
+  list_push_back (&tid_buckets[(unsigned) t->tid % TID_BUCKETS],
+                  &t->tid_elem);
+  intr_set_level (old_level);
+
+  return t->tid;
 }
 
 /* Offset of `stack' member within `struct thread'.
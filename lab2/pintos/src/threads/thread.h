@@ -3,7 +3,9 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -14,15 +16,53 @@ enum thread_status
     THREAD_DYING        /* About to be destroyed. */
   };
 
+/* Sets of threads, by what they are doing.  Every thread is in
+   exactly one.  See thread_foreach_in(). */
+enum thread_set
+  {
+    THREADS_RUNNABLE,   /* Running or ready to run. */
+    THREADS_SLEEPING,   /* Blocked in the timer, until a time. */
+    THREADS_BLOCKED,    /* Blocked on anything else. */
+    THREADS_DYING,      /* Exited, not yet destroyed. */
+    THREADS_SET_CNT     /* Number of sets. */
+  };
+
 /* Thread identifier type.
    You can redefine this to whatever type you like. */
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1)          /* Error value for tid_t. */
 
+struct lock;
+struct cpu;
+struct fpu_state;
+
 /* Thread priorities. */
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1) /* Number of priorities. */
+
+/* Thread niceness, for the MLFQS and CFS. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Tickets, for the stride scheduler. */
+#define TICKETS_MIN 1                   /* Fewest tickets. */
+#define TICKETS_DEFAULT 100             /* Default tickets. */
+#define TICKETS_MAX 10000               /* Most tickets. */
+
+/* Histogram of wakeup latencies.  Bucket B counts latencies of
+   2**B to 2**(B+1) microseconds, except that bucket 0 also counts
+   shorter ones and the last bucket also counts longer ones. */
+#define LATENCY_BUCKETS 20
+struct latency_hist
+  {
+    uint32_t cnt;                       /* Number of samples. */
+    int64_t total_ns;                   /* Sum of all samples. */
+    int64_t max_ns;                     /* Largest sample. */
+    uint32_t hist[LATENCY_BUCKETS];     /* Histogram of samples. */
+  };
 
 /* A kernel thread or user process.
 
@@ -74,12 +114,14 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member has a triple purpose.  It can be an element
+   in the run queue (thread.c), an element in a semaphore wait
+   list (synch.c), or an element in one of the sleep lists
+   (timer.c).  It can be used these three ways only because they
+   are mutually exclusive: only a thread in the ready state is on
+   the run queue, whereas only a thread in the blocked state is on
+   a semaphore wait list or a sleep list, and a thread blocked on
+   one of these is never on another. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -87,14 +129,96 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
-    struct list_elem allelem;           /* List element for all threads list. */
+    int priority;                       /* Priority, including donations. */
+    int base_priority;                  /* Priority, before donations. */
+    enum thread_set set;                /* Set of threads it is in. */
+    struct list_elem set_elem;          /* List element for that set. */
+    struct list_elem tid_elem;          /* List element in tid table. */
+    struct cpu *cpu;                    /* CPU it runs or last ran on. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct list held_locks;             /* Locks held, for donations. */
+    struct lock *waiting_lock;          /* Lock being waited for, if any. */
     int64_t blocked_until;		/* Used to store at what value of ticks the thread
 					   should change state from BLOCKED to READY. */
-    bool isSleeping;
+    uint64_t wakeup_cycles;             /* TSC value at which a sub-tick
+                                           sleep ends. */
+    int64_t timer_slack;                /* Ticks a sleep may overrun. */
+    tid_t handoff_tid;                  /* Thread to run in its place if
+                                           it blocks, or 0. */
+
+    /* Owned by thread.c, for the MLFQS. */
+    int nice;                           /* Niceness. */
+    fixed_point recent_cpu;             /* Recent CPU time, in ticks. */
+    bool cpu_dirty;                     /* In `cpu_dirty_list'? */
+    struct list_elem cpu_dirty_elem;    /* List element for same. */
+    int64_t mlfqs_stamp;                /* While blocked, the second
+                                           recent_cpu was last decayed,
+                                           or -1 if not blocked. */
+    struct list_elem mlfqs_elem;        /* List element while blocked. */
+
+    /* Owned by thread.c, for the CFS. */
+    int64_t vruntime;                   /* Weighted run time, in ns. */
+    int64_t slice_ns;                   /* Run time since last switch. */
+
+    /* Owned by thread.c, for the stride scheduler. */
+    int base_tickets;                   /* Tickets, before transfers. */
+    int tickets;                        /* Tickets, including transfers. */
+    int64_t pass;                       /* Virtual time of next run. */
+    int64_t pass_remain;                /* While blocked, `pass' less
+                                           its CPU's global pass. */
+
+    /* Owned by thread.c, for the CFS and stride scheduler. */
+    struct rb_elem fair_elem;           /* Tree element for run queue. */
+
+    /* Owned by thread.c, for the EDF class.  Times are in ticks. */
+    int64_t dl_period;                  /* Period, or 0 if not EDF. */
+    int64_t dl_runtime;                 /* Budget per period. */
+    int64_t dl_deadline;                /* Deadline, from release. */
+    int64_t dl_bw;                      /* Share of CPU admitted. */
+    int64_t dl_release;                 /* Start of current job. */
+    int64_t dl_abs_deadline;            /* Deadline of current job. */
+    int64_t dl_budget;                  /* Budget left to current job. */
+    bool dl_throttled;                  /* Out of budget until next
+                                           period? */
+    int dl_jobs;                        /* # of jobs finished. */
+    int dl_misses;                      /* # of jobs finished late. */
+
+    /* Owned by thread.c, for statistics.  Times are in ns. */
+    int64_t wakeup_ns;                  /* When last unblocked, or 0 if
+                                           it has run since. */
+    int64_t run_start_ns;               /* When last switched in. */
+    int64_t run_ns;                     /* Total time run. */
+    uint32_t voluntary_switches;        /* # of switches out to block. */
+    uint32_t involuntary_switches;      /* # of switches out while
+                                           still ready. */
+    struct latency_hist wakeup_latency; /* Unblock to switch in. */
+    int64_t user_ticks;                 /* # of ticks in user program. */
+    int64_t kernel_ticks;               /* # of ticks in kernel. */
+    int64_t sleep_start_ns;             /* When last put to sleep. */
+    int64_t sleep_ns;                   /* Total time asleep in timer. */
+
+    /* Owned by synch.c, for statistics. */
+    int64_t lock_wait_ns;               /* Total time waiting for locks,
+                                           in ns. */
+
+    /* Updated by devices/block.c and palloc.c, for statistics. */
+    uint32_t sectors_read;              /* # of sectors read. */
+    uint32_t sectors_written;           /* # of sectors written. */
+    uint32_t pages_allocated;           /* # of pages allocated. */
+
+    /* Owned by top.c. */
+    int64_t top_ticks;                  /* User and kernel ticks at last
+                                           dump. */
+
+    /* Owned by fpu.c. */
+    struct fpu_state *fpu;              /* Saved FPU state, or null. */
+    struct fpu_state *fpu_kernel;       /* Same, for fpu_begin(). */
+    bool fpu_in_kernel;                 /* Between fpu_begin() and
+                                           fpu_end()? */
+    bool fpu_used;                      /* State loaded in the CPU? */
+    struct cpu *fpu_cpu;                /* CPU that last loaded it. */
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
@@ -109,17 +233,37 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
+/* If true, use the stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* If true, a thread that wakes another and then blocks hands
+   the rest of its time slice to the thread it woke.
+   Controlled by kernel command-line option "-handoff". */
+extern bool thread_handoff;
+
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_prepare_ap (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t);
 void thread_print_stats (void);
+long long thread_context_switches (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
+void thread_sleep (void);
 void thread_unblock (struct thread *);
+void thread_hand_off (struct thread *);
+struct thread *thread_lookup (tid_t);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -127,13 +271,32 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
+void thread_foreach_in (enum thread_set, thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int);
+void thread_update_priority (struct thread *);
+bool thread_priority_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
+
+int64_t thread_get_timer_slack (void);
+void thread_set_timer_slack (int64_t);
+
+bool thread_set_deadline (int64_t period, int64_t runtime,
+                          int64_t deadline);
+void thread_wait_period (void);
+int thread_get_deadline_misses (void);
+
+int thread_get_tickets (void);
+void thread_set_tickets (int);
+void thread_transfer_tickets (struct thread *, int);
+void thread_update_tickets (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -0,0 +1,174 @@
+#include "threads/top.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* The dump runs as delayed work on the system work queue, which
+   queues it again each time it runs.  It copies what it prints
+   into rows[] with interrupts off, so that the threads cannot
+   change or go away under it, and prints with interrupts on, so
+   that printing to a slow console does not hold up the rest of
+   the machine. */
+
+/* Number of threads shown. */
+#define TOP_ROWS 10
+
+/* Seconds between dumps, or 0 for none. */
+int top_interval;
+
+/* What is shown of a thread. */
+struct top_row
+  {
+    tid_t tid;
+    char name[16];
+    char state;                 /* See state_char(). */
+    int priority;
+    int64_t ticks;              /* Ticks run since last dump. */
+    int64_t user_ticks;
+    int64_t kernel_ticks;
+    uint32_t switches;          /* Voluntary and involuntary. */
+    int64_t lock_wait_ns;
+    int64_t sleep_ns;
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    uint32_t pages_allocated;
+  };
+
+/* Snapshot of the threads, taken by take_snapshot(). */
+struct snapshot
+  {
+    struct top_row rows[TOP_ROWS]; /* Busiest first. */
+    int row_cnt;                /* Number of rows in use. */
+    int thread_cnt;             /* Number of threads seen. */
+  };
+
+static struct delayed_work top_work;
+static int64_t last_dump;       /* Tick of last dump. */
+
+static work_func top_dump;
+static thread_action_func take_snapshot;
+static char state_char (const struct thread *);
+
+/* Starts dumping the busiest threads every top_interval
+   seconds, if top_interval is nonzero.  Must be called after
+   workqueue_init(). */
+void
+top_init (void) 
+{
+  if (top_interval <= 0)
+    return;
+
+  last_dump = timer_ticks ();
+  delayed_work_init (&top_work, top_dump, NULL);
+  work_queue_delayed (&top_work, top_interval * TIMER_FREQ);
+}
+
+/* Prints the threads that ran the most since the last call. */
+void
+top_print (void) 
+{
+  static struct snapshot snap;
+  enum intr_level old_level;
+  int64_t now, elapsed;
+  int i;
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  elapsed = now - last_dump;
+  last_dump = now;
+  snap.row_cnt = snap.thread_cnt = 0;
+  thread_foreach (take_snapshot, &snap);
+  intr_set_level (old_level);
+
+  printf ("top: %"PRId64" s up, %d threads, busiest over last "
+          "%"PRId64" ticks:\n", now / TIMER_FREQ, snap.thread_cnt, elapsed);
+  printf ("top:   TID NAME             S PRI  %%CPU   USER KERNEL"
+          "  SWTCH LOCK-MS SLEEP-MS SEC-RD SEC-WR  PAGES\n");
+  for (i = 0; i < snap.row_cnt; i++) 
+    {
+      const struct top_row *r = &snap.rows[i];
+      int64_t permille = elapsed > 0 ? r->ticks * 1000 / elapsed : 0;
+
+      printf ("top: %5d %-16s %c %3d %3"PRId64".%"PRId64" %6"PRId64
+              " %6"PRId64" %6"PRIu32" %7"PRId64" %8"PRId64
+              " %6"PRIu32" %6"PRIu32" %6"PRIu32"\n",
+              r->tid, r->name, r->state, r->priority,
+              permille / 10, permille % 10, r->user_ticks,
+              r->kernel_ticks, r->switches, r->lock_wait_ns / 1000000,
+              r->sleep_ns / 1000000, r->sectors_read, r->sectors_written,
+              r->pages_allocated);
+    }
+}
+
+/* Dumps the busiest threads, then queues itself to do so again
+   in top_interval seconds. */
+static void
+top_dump (void *aux UNUSED) 
+{
+  top_print ();
+  work_queue_delayed (&top_work, top_interval * TIMER_FREQ);
+}
+
+/* Adds thread T to snapshot SNAP_ if it is among the TOP_ROWS
+   threads seen so far that ran the most ticks since the last
+   dump, and starts counting T's ticks afresh. */
+static void
+take_snapshot (struct thread *t, void *snap_) 
+{
+  struct snapshot *snap = snap_;
+  int64_t total = t->user_ticks + t->kernel_ticks;
+  int64_t ticks = total - t->top_ticks;
+  struct top_row *r;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->top_ticks = total;
+  snap->thread_cnt++;
+
+  /* Find T's place, moving less busy rows down to make room. */
+  i = snap->row_cnt < TOP_ROWS ? snap->row_cnt++ : TOP_ROWS;
+  for (; i > 0 && snap->rows[i - 1].ticks < ticks; i--)
+    if (i < TOP_ROWS)
+      snap->rows[i] = snap->rows[i - 1];
+  if (i >= TOP_ROWS)
+    return;
+
+  r = &snap->rows[i];
+  r->tid = t->tid;
+  strlcpy (r->name, t->name, sizeof r->name);
+  r->state = state_char (t);
+  r->priority = t->priority;
+  r->ticks = ticks;
+  r->user_ticks = t->user_ticks;
+  r->kernel_ticks = t->kernel_ticks;
+  r->switches = t->voluntary_switches + t->involuntary_switches;
+  r->lock_wait_ns = t->lock_wait_ns;
+  r->sleep_ns = t->sleep_ns;
+  r->sectors_read = t->sectors_read;
+  r->sectors_written = t->sectors_written;
+  r->pages_allocated = t->pages_allocated;
+}
+
+/* Returns a letter for T's state: R for running, r for ready, S
+   for asleep in the timer, L for waiting for a lock, B for
+   blocked on anything else. */
+static char
+state_char (const struct thread *t) 
+{
+  if (t->status == THREAD_RUNNING)
+    return 'R';
+  else if (t->status == THREAD_READY)
+    return 'r';
+  else if (t->set == THREADS_SLEEPING)
+    return 'S';
+  else if (t->waiting_lock != NULL)
+    return 'L';
+  else
+    return 'B';
+}
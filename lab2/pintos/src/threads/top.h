@@ -0,0 +1,19 @@
+#ifndef THREADS_TOP_H
+#define THREADS_TOP_H
+
+/* Periodic dump of the threads that use the most CPU time, like
+   the Unix `top' utility, over the console.
+
+   Every top_interval seconds, prints a line for each of the
+   TOP_ROWS threads that ran the most timer ticks since the
+   previous dump, with its share of a CPU over that time and the
+   resources it has used since it was created. */
+
+/* Seconds between dumps, or 0 for none.
+   Controlled by kernel command-line option "-top=SECONDS". */
+extern int top_interval;
+
+void top_init (void);
+void top_print (void);
+
+#endif /* threads/top.h */
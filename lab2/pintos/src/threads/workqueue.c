@@ -0,0 +1,314 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Each queue keeps a list of pending work items for each CPU,
+   which work queued on that CPU goes into, and its workers look
+   first at the list of the CPU they run on, so that work tends
+   to run where its data is.
+
+   Once awake, a worker runs work items until none are left, so
+   that a burst of work items costs a single wakeup.  Queuing a
+   work item only wakes a worker if every worker is either
+   waiting or in the middle of running a work item, which may be
+   asleep, so that one work item that sleeps does not hold up the
+   rest of the queue while another worker could run them. */
+
+/* Number of worker threads in the system queue. */
+#define SYSTEM_WORKERS 4
+
+/* The system queue. */
+static struct workqueue system_wq;
+
+/* All queues, for statistics. */
+static struct list all_queues;
+
+static thread_func worker;
+static struct work *take_work (struct workqueue *);
+static void wake_worker (struct workqueue *);
+static void delayed_work_timer (void *dw_);
+
+/* Initializes the work queue subsystem and creates the system
+   queue.  Must be called after thread_start(). */
+void
+workqueue_init (void) 
+{
+  list_init (&all_queues);
+  if (!workqueue_create (&system_wq, "events", SYSTEM_WORKERS))
+    PANIC ("could not create system work queue");
+}
+
+/* Initializes WQ as a queue named NAME, and starts WORKERS worker
+   threads to run its work.  Returns true if successful, false if
+   no worker thread could be created.  The queue lasts forever,
+   so WQ must be static. */
+bool
+workqueue_create (struct workqueue *wq, const char *name, int workers) 
+{
+  enum intr_level old_level;
+  int started = 0;
+  int i;
+
+  ASSERT (wq != NULL);
+  ASSERT (workers > 0);
+
+  wq->name = name;
+  for (i = 0; i < CPU_MAX; i++)
+    list_init (&wq->pending[i]);
+  wq->pending_cnt = 0;
+  wq->worker_cnt = 0;
+  wq->idle_cnt = 0;
+  wq->running_cnt = 0;
+  sema_init (&wq->wake, 0);
+  wq->work_cnt = wq->batch_cnt = 0;
+
+  for (i = 0; i < workers; i++) 
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+      old_level = intr_disable ();
+      wq->worker_cnt++;
+      intr_set_level (old_level);
+      if (thread_create (thread_name, PRI_DEFAULT, worker, wq) != TID_ERROR)
+        started++;
+      else 
+        {
+          old_level = intr_disable ();
+          wq->worker_cnt--;
+          intr_set_level (old_level);
+        }
+    }
+  if (started == 0)
+    return false;
+
+  old_level = intr_disable ();
+  list_push_back (&all_queues, &wq->elem);
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Prints statistics for every queue. */
+void
+workqueue_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_queues); e != list_end (&all_queues);
+       e = list_next (e))
+    {
+      struct workqueue *wq = list_entry (e, struct workqueue, elem);
+      printf ("Workqueue: %s: %"PRId64" work items in %"PRId64
+              " batches\n", wq->name, wq->work_cnt, wq->batch_cnt);
+    }
+}
+
+/* Initializes W to call FUNC with AUX when it runs. */
+void
+work_init (struct work *w, work_func *func, void *aux) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->wq = NULL;
+  w->pending = false;
+}
+
+/* Queues W on the system queue.  Returns true if successful,
+   false if W was already pending. */
+bool
+work_queue (struct work *w) 
+{
+  return work_queue_on (&system_wq, w);
+}
+
+/* Queues W on WQ, on the running CPU's list.  Returns true if
+   successful, false if W was already pending, in which case it
+   still runs only once. */
+bool
+work_queue_on (struct workqueue *wq, struct work *w) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (!w->pending) 
+    {
+      w->pending = true;
+      w->wq = wq;
+      list_push_back (&wq->pending[cpu_current ()->id], &w->elem);
+      wq->pending_cnt++;
+      if (wq->worker_cnt - wq->idle_cnt - wq->running_cnt == 0)
+        wake_worker (wq);
+      queued = true;
+    }
+  intr_set_level (old_level);
+  return queued;
+}
+
+/* Removes W from its queue if it is pending.  Returns true if it
+   was, false if it was not queued or has already started to run,
+   in which case it may still be running. */
+bool
+work_cancel (struct work *w) 
+{
+  enum intr_level old_level;
+  bool cancelled = false;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (w->pending) 
+    {
+      list_remove (&w->elem);
+      w->wq->pending_cnt--;
+      w->pending = false;
+      cancelled = true;
+    }
+  intr_set_level (old_level);
+  return cancelled;
+}
+
+/* Initializes DW to call FUNC with AUX when it runs. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func, void *aux) 
+{
+  ASSERT (dw != NULL);
+
+  work_init (&dw->work, func, aux);
+  timer_setup (&dw->timer, delayed_work_timer, dw);
+}
+
+/* Queues DW on the system queue TICKS timer ticks from now.
+   Returns true if successful, false if DW was already waiting or
+   pending. */
+bool
+work_queue_delayed (struct delayed_work *dw, int64_t ticks) 
+{
+  return work_queue_delayed_on (&system_wq, dw, ticks);
+}
+
+/* Queues DW on WQ TICKS timer ticks from now, or at once if TICKS
+   is 0 or negative.  Returns true if successful, false if DW was
+   already waiting or pending. */
+bool
+work_queue_delayed_on (struct workqueue *wq, struct delayed_work *dw,
+                       int64_t ticks) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (dw != NULL);
+
+  if (ticks <= 0)
+    return work_queue_on (wq, &dw->work);
+
+  old_level = intr_disable ();
+  if (!dw->work.pending && !timer_pending (&dw->timer)) 
+    {
+      dw->work.wq = wq;
+      timer_add (&dw->timer, ticks);
+      queued = true;
+    }
+  intr_set_level (old_level);
+  return queued;
+}
+
+/* Cancels DW, whether it is still waiting for its delay or
+   already pending.  Returns true if it was either, false if it
+   was not queued or has already started to run. */
+bool
+delayed_work_cancel (struct delayed_work *dw) 
+{
+  enum intr_level old_level;
+  bool cancelled;
+
+  ASSERT (dw != NULL);
+
+  old_level = intr_disable ();
+  cancelled = timer_cancel (&dw->timer) || work_cancel (&dw->work);
+  intr_set_level (old_level);
+  return cancelled;
+}
+
+/* Timer callback that queues delayed work DW_ once its delay is
+   over. */
+static void
+delayed_work_timer (void *dw_) 
+{
+  struct delayed_work *dw = dw_;
+
+  work_queue_on (dw->work.wq, &dw->work);
+}
+
+/* Wakes one of WQ's waiting workers, if any.  Interrupts must be
+   off. */
+static void
+wake_worker (struct workqueue *wq) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (wq->idle_cnt > 0) 
+    {
+      wq->idle_cnt--;
+      sema_up (&wq->wake);
+    }
+}
+
+/* Removes and returns the next pending work item on WQ, from the
+   running CPU's list if it has any, or a null pointer if no work
+   is pending.  Interrupts must be off. */
+static struct work *
+take_work (struct workqueue *wq) 
+{
+  struct list *pending = &wq->pending[cpu_current ()->id];
+  unsigned i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (wq->pending_cnt == 0)
+    return NULL;
+  for (i = 0; list_empty (pending); i++)
+    pending = &wq->pending[i];
+  wq->pending_cnt--;
+  return list_entry (list_pop_front (pending), struct work, elem);
+}
+
+/* Worker thread for queue WQ_.  Runs work items until there are
+   none left, then waits to be woken. */
+static void
+worker (void *wq_) 
+{
+  struct workqueue *wq = wq_;
+
+  intr_disable ();
+  for (;;) 
+    {
+      struct work *w = take_work (wq);
+
+      if (w == NULL) 
+        {
+          wq->idle_cnt++;
+          sema_down (&wq->wake);
+          wq->batch_cnt++;
+          continue;
+        }
+
+      w->pending = false;
+      wq->work_cnt++;
+      wq->running_cnt++;
+      intr_enable ();
+      w->func (w->aux);
+      intr_disable ();
+      wq->running_cnt--;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer-wheel.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+
+/* Work queues: functions to run later in a kernel thread, for
+   work too heavy for an interrupt handler or too small to be
+   worth a thread of its own.
+
+   Each queue has a fixed pool of worker threads that run its
+   work items, in the order queued on each CPU.  The caller owns
+   each work item, which it may queue again once it has started
+   to run, so that queuing never allocates memory.  Work items
+   may be queued from kernel threads or from external interrupt
+   handlers, and may sleep when they run.
+
+   The system queue, used by work_queue() and work_queue_delayed(),
+   suits most work.  Work that may sleep for a long time should
+   have a queue of its own, so as not to hold up other work. */
+
+/* Work function. */
+typedef void work_func (void *aux);
+
+/* A work item. */
+struct work
+  {
+    struct list_elem elem;      /* Element in a queue's pending list. */
+    work_func *func;            /* Function to call. */
+    void *aux;                  /* Argument for FUNC. */
+    struct workqueue *wq;       /* Queue last queued on. */
+    bool pending;               /* Queued, not yet started? */
+  };
+
+/* A work item that is queued after a delay. */
+struct delayed_work
+  {
+    struct work work;           /* The work item. */
+    struct timer timer;         /* Queues WORK when it expires. */
+  };
+
+/* A work queue. */
+struct workqueue
+  {
+    const char *name;           /* Name, for worker threads. */
+    struct list_elem elem;      /* Element in list of all queues. */
+    struct list pending[CPU_MAX]; /* Work queued on each CPU. */
+    int pending_cnt;            /* Number of pending work items. */
+    int worker_cnt;             /* Number of worker threads. */
+    int idle_cnt;               /* Number of workers waiting. */
+    int running_cnt;            /* Number of workers running work. */
+    struct semaphore wake;      /* Wakes waiting workers. */
+    int64_t work_cnt;           /* Number of work items run. */
+    int64_t batch_cnt;          /* Number of times a worker woke. */
+  };
+
+void workqueue_init (void);
+bool workqueue_create (struct workqueue *, const char *name, int workers);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+bool work_queue_on (struct workqueue *, struct work *);
+bool work_cancel (struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *, void *aux);
+bool work_queue_delayed (struct delayed_work *, int64_t ticks);
+bool work_queue_delayed_on (struct workqueue *, struct delayed_work *,
+                            int64_t ticks);
+bool delayed_work_cancel (struct delayed_work *);
+
+#endif /* threads/workqueue.h */